@@ -1,4 +1,28 @@
-int marching_cubes_lut[256][16] =
+// TriTable.hpp
+// Lookup tables for the Marching Cubes algorithm.
+// All tables are constexpr and byte-sized: the triangle table is 4 KB instead of 16 KB, and the
+// per-case edge mask and triangle count are derived from it at compile time.
+
+#ifndef MARCHING_TRITABLE_HPP
+#define MARCHING_TRITABLE_HPP
+
+#include <cstdint>
+
+// Cube corner offsets (x, y, z) in the order used by the case index bits
+constexpr int8_t marching_cubes_corners[8][3] = {
+    {0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1},
+    {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1}
+};
+
+// Corner pairs of the 12 cube edges
+constexpr int8_t marching_cubes_edges[12][2] = {
+    {0, 1}, {1, 2}, {2, 3}, {3, 0},
+    {4, 5}, {5, 6}, {6, 7}, {7, 4},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+
+// Edges of the triangles of every case, three per triangle, terminated by -1
+constexpr int8_t marching_cubes_lut[256][16] =
 {{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
 {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
 {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
@@ -257,8 +281,36 @@ int marching_cubes_lut[256][16] =
 {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
 };
 
+// Per-case tables derived from marching_cubes_lut at compile time
+struct MarchingCubesCaseTables {
+    uint16_t edgeFlags[256]; // Bit e is set when edge e carries a triangle vertex
+    uint8_t triCount[256];   // Number of triangles
+};
+
+constexpr MarchingCubesCaseTables make_case_tables() {
+    MarchingCubesCaseTables tables = {};
+    for (int c = 0; c < 256; ++c) {
+        int edges = 0;
+        uint16_t flags = 0;
+        while (edges < 16 && marching_cubes_lut[c][edges] != -1) {
+            flags = static_cast<uint16_t>(flags | (1u << marching_cubes_lut[c][edges]));
+            ++edges;
+        }
+        tables.edgeFlags[c] = flags;
+        tables.triCount[c] = static_cast<uint8_t>(edges / 3);
+    }
+    return tables;
+}
+
+constexpr MarchingCubesCaseTables marching_cubes_cases = make_case_tables();
+
+static_assert(marching_cubes_cases.triCount[0] == 0 && marching_cubes_cases.triCount[255] == 0,
+              "empty and full cubes produce no triangles");
+static_assert(marching_cubes_cases.edgeFlags[1] == ((1 << 0) | (1 << 3) | (1 << 8)),
+              "case 1 cuts the three edges of corner 0");
+
 
-float vertTable[12][3] = {
+constexpr float vertTable[12][3] = {
 	{0.5f, 0.0f, 0.0f},
 	{1.0f, 0.0f, 0.5f},
 	{0.5f, 0.0f, 1.0f},
@@ -273,3 +325,4 @@ float vertTable[12][3] = {
 	{0.0f, 0.5f, 1.0f},
 };
 
+#endif // MARCHING_TRITABLE_HPP
@@ -0,0 +1,545 @@
+// distributed.cpp
+// This file implements the distributed extraction mode declared in distributed.hpp: the brick files
+// written by the workers, the worker loop, the seam stitching and the coordinator.
+
+#include "distributed.hpp"
+#include "marching_kernel.hpp" // Lattice sweep and edge slots
+#include "log.hpp"
+#include "memory.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <dirent.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+const char BrickMagic[8] = {'M', 'C', 'B', 'R', 'I', 'C', 'K', '1'};
+
+// Start of a brick file; followed by the vertices, then by the triangles as three uint32 each
+struct BrickFileHeader {
+    char magic[8];
+    std::uint32_t brick;
+    std::uint32_t vertices;
+    std::uint64_t triangles;
+};
+
+// A brick vertex. The key identifies its global lattice edge: 3 * (index of the lower lattice point) + axis.
+struct BrickVertex {
+    std::uint64_t key;
+    float position[3];
+    float normal[3];
+};
+
+// Id of the lattice edge leaving point p along axis
+std::uint64_t edgeKey(const Lattice& lattice, const glm::ivec3& p, int axis) {
+    std::uint64_t point = (static_cast<std::uint64_t>(p.x) * (lattice.cells.y + 1) + p.y) * (lattice.cells.z + 1) + p.z;
+    return point * 3 + axis;
+}
+
+// True if the edge lies in a face shared by two bricks, where both of them produce its vertex
+bool onSeam(const BrickJob& job, std::uint64_t key) {
+    const Lattice& lattice = job.lattice;
+    int axis = static_cast<int>(key % 3);
+    std::uint64_t point = key / 3;
+    glm::ivec3 p;
+    p.z = static_cast<int>(point % (lattice.cells.z + 1));
+    point /= lattice.cells.z + 1;
+    p.y = static_cast<int>(point % (lattice.cells.y + 1));
+    p.x = static_cast<int>(point / (lattice.cells.y + 1));
+    for (int d = 0; d < 3; ++d) {
+        if (d != axis && p[d] > 0 && p[d] < lattice.cells[d] && p[d] % job.brickCells[d] == 0) return true;
+    }
+    return false;
+}
+
+std::string jobPath(const std::string& dir) {
+    return dir + "/job.txt";
+}
+
+bool readFloats(std::istringstream& line, float* values, int count) {
+    std::string word;
+    for (int i = 0; i < count; ++i) {
+        if (!(line >> word)) return false;
+        char* end = nullptr;
+        values[i] = std::strtof(word.c_str(), &end);
+        if (*end != '\0') return false;
+    }
+    return true;
+}
+
+// Writes size bytes or fails
+bool writeAll(std::FILE* file, const void* data, size_t size) {
+    return size == 0 || std::fwrite(data, 1, size, file) == size;
+}
+
+bool readAll(std::FILE* file, void* data, size_t size) {
+    return size == 0 || std::fread(data, 1, size, file) == size;
+}
+
+// Appends the contents of file from to file to
+bool appendFile(std::FILE* to, const std::string& from) {
+    std::FILE* in = std::fopen(from.c_str(), "rb");
+    if (!in) return false;
+    std::vector<char> buffer(1 << 20);
+    bool ok = true;
+    size_t n;
+    while (ok && (n = std::fread(buffer.data(), 1, buffer.size(), in)) > 0)
+        ok = writeAll(to, buffer.data(), n);
+    ok = ok && !std::ferror(in);
+    std::fclose(in);
+    return ok;
+}
+
+// Absolute path of the running executable, which the workers run as well
+std::string executablePath() {
+    char path[4096];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n <= 0) return "";
+    path[n] = '\0';
+    return path;
+}
+
+std::string absolutePath(const std::string& path) {
+    char* resolved = realpath(path.c_str(), nullptr);
+    if (!resolved) return path;
+    std::string result = resolved;
+    std::free(resolved);
+    return result;
+}
+
+// Quotes a word for /bin/sh
+std::string shellQuote(const std::string& word) {
+    std::string quoted = "'";
+    for (char c : word) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+// Starts worker index through /bin/sh; returns its pid, or -1.
+// With a launcher the worker command is passed to it as a single, quoted argument that the far side
+// parses as a shell command again: ssh hands it to the remote shell as is, and launchers that run
+// argv directly (srun) are given "sh -c" as their last words.
+pid_t launchWorker(const std::string& exe, const DistributedOptions& options, const std::string& dir,
+                   int index, int stride) {
+    std::string prefix = options.launcher;
+    for (size_t at; (at = prefix.find("{}")) != std::string::npos;)
+        prefix.replace(at, 2, std::to_string(index));
+    std::string worker = shellQuote(exe) + " --brick-worker " + shellQuote(dir) + " " + std::to_string(index) +
+                         " " + std::to_string(stride);
+    std::string command = prefix.empty() ? worker : prefix + " " + shellQuote(worker);
+    LOG_DEBUG("Launching worker {}: {}", index, command);
+
+    const char* args[] = {"sh", "-c", command.c_str(), nullptr};
+    pid_t pid;
+    if (posix_spawn(&pid, "/bin/sh", nullptr, nullptr, const_cast<char* const*>(args), environ) != 0) {
+        LOG_ERROR("Could not launch worker {}", index);
+        return -1;
+    }
+    return pid;
+}
+
+// Launches the given workers and waits for all of them
+void runWorkers(const std::string& exe, const DistributedOptions& options, const std::string& dir,
+                const std::vector<int>& indices, int stride) {
+    std::vector<std::pair<pid_t, int>> running;
+    for (int index : indices) {
+        pid_t pid = launchWorker(exe, options, dir, index, stride);
+        if (pid > 0) running.emplace_back(pid, index);
+    }
+    for (auto& [pid, index] : running) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0) {
+            LOG_WARN("Lost worker {}", index);
+        } else if (WIFSIGNALED(status)) {
+            LOG_WARN("Worker {} was killed by signal {}", index, WTERMSIG(status));
+        } else if (WEXITSTATUS(status) != 0) {
+            LOG_WARN("Worker {} failed with exit code {}", index, WEXITSTATUS(status));
+        }
+    }
+}
+
+bool fileExists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// Removes the partial brick files (brick_XXXXXX.bin.tmp<pid>) that workers killed mid-write left
+// behind; call only while no worker runs
+void removePartialBricks(const std::string& dir) {
+    DIR* listing = opendir(dir.c_str());
+    if (!listing) return;
+    int removed = 0;
+    while (dirent* entry = readdir(listing)) {
+        const char* name = entry->d_name;
+        if (std::strncmp(name, "brick_", 6) == 0 && std::strstr(name, ".bin.tmp") != nullptr)
+            removed += std::remove((dir + "/" + name).c_str()) == 0;
+    }
+    closedir(listing);
+    if (removed > 0)
+        LOG_DEBUG("Removed {} partial brick files from {}", removed, dir);
+}
+
+} // namespace
+
+glm::ivec3 BrickJob::brickGrid() const {
+    return (lattice.cells + brickCells - 1) / brickCells;
+}
+
+int BrickJob::brickCount() const {
+    glm::ivec3 grid = brickGrid();
+    return grid.x * grid.y * grid.z;
+}
+
+void BrickJob::brickRange(int index, glm::ivec3& begin, glm::ivec3& end) const {
+    glm::ivec3 grid = brickGrid();
+    glm::ivec3 brick(index % grid.x, (index / grid.x) % grid.y, index / (grid.x * grid.y));
+    begin = brick * brickCells;
+    end = glm::min(begin + brickCells, lattice.cells);
+}
+
+bool write_brick_job(const std::string& dir, const BrickJob& job) {
+    std::string path = jobPath(dir), temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "w");
+    if (!file) {
+        LOG_ERROR("Could not write {}", temporary);
+        return false;
+    }
+    const Lattice& l = job.lattice;
+    std::fprintf(file, "isovalue %a\n", job.isovalue);
+    std::fprintf(file, "min %a %a %a\n", l.min.x, l.min.y, l.min.z);
+    std::fprintf(file, "step %a %a %a\n", l.step.x, l.step.y, l.step.z);
+    std::fprintf(file, "cells %d %d %d\n", l.cells.x, l.cells.y, l.cells.z);
+    std::fprintf(file, "brick %d %d %d\n", job.brickCells.x, job.brickCells.y, job.brickCells.z);
+    bool ok = std::fclose(file) == 0;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("Could not write {}", path);
+        return false;
+    }
+    return true;
+}
+
+bool read_brick_job(const std::string& dir, BrickJob& job) {
+    std::string path = jobPath(dir);
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Could not open {}", path);
+        return false;
+    }
+    BrickJob read;
+    int found = 0;
+    std::string text;
+    while (std::getline(file, text)) {
+        std::istringstream line(text);
+        std::string name;
+        if (!(line >> name)) continue;
+        bool ok;
+        if (name == "isovalue") ok = readFloats(line, &read.isovalue, 1);
+        else if (name == "min") ok = readFloats(line, &read.lattice.min.x, 3);
+        else if (name == "step") ok = readFloats(line, &read.lattice.step.x, 3);
+        else if (name == "cells") ok = bool(line >> read.lattice.cells.x >> read.lattice.cells.y >> read.lattice.cells.z);
+        else if (name == "brick") ok = bool(line >> read.brickCells.x >> read.brickCells.y >> read.brickCells.z);
+        else ok = false;
+        if (!ok) {
+            LOG_ERROR("{}: bad line '{}'", path, text);
+            return false;
+        }
+        ++found;
+    }
+    const glm::ivec3& cells = read.lattice.cells;
+    const glm::ivec3& brick = read.brickCells;
+    if (found != 5 || std::min({cells.x, cells.y, cells.z, brick.x, brick.y, brick.z}) < 1) {
+        LOG_ERROR("{}: incomplete job", path);
+        return false;
+    }
+    job = read;
+    return true;
+}
+
+std::string brick_path(const std::string& dir, int index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/brick_%06d.bin", index);
+    return dir + name;
+}
+
+// The brick is swept on a lattice of its own in index space (point (x, y, z) at (x, y, z)), so that
+// every sample and every vertex is computed from global lattice points exactly as its neighbours do
+bool extract_brick(const std::function<float(float, float, float)>& f, const BrickJob& job, int index,
+                   const std::string& path) {
+    static Counter& jobs = metrics_counter("marching_meshing_jobs_total", "Meshing jobs run", "engine=\"brick\"");
+    static Histogram& seconds = metrics_histogram("marching_meshing_seconds", "Duration of meshing jobs",
+                                                  {0.001, 0.01, 0.1, 0.5, 1, 5, 30, 120}, "engine=\"brick\"");
+    auto start = std::chrono::steady_clock::now();
+    MemoryScope scope(MEM_MESHING);
+
+    const Lattice& global = job.lattice;
+    glm::ivec3 begin, end;
+    job.brickRange(index, begin, end);
+    Lattice local{glm::vec3(0.0f), glm::vec3(1.0f), end - begin};
+    auto sample = [&](float x, float y, float z) {
+        glm::vec3 p = global.point(begin.x + static_cast<int>(x), begin.y + static_cast<int>(y),
+                                   begin.z + static_cast<int>(z));
+        return f(p.x, p.y, p.z);
+    };
+
+    float h = 0.5f * std::min(global.step.x, std::min(global.step.y, global.step.z));
+    auto normal = [&](const glm::vec3& p) {
+        glm::vec3 g(f(p.x + h, p.y, p.z) - f(p.x - h, p.y, p.z),
+                    f(p.x, p.y + h, p.z) - f(p.x, p.y - h, p.z),
+                    f(p.x, p.y, p.z + h) - f(p.x, p.y, p.z - h));
+        float length = glm::length(g);
+        return length > 0.0f ? g / length : g; // Same direction as compute_normals()
+    };
+
+    std::vector<BrickVertex> vertices;
+    std::vector<std::uint32_t> triangles;
+    std::unordered_map<std::uint64_t, std::uint32_t> byKey;
+    MarchingWorkspace workspace;
+    march_lattice(local, sample, job.isovalue, workspace, 0, local.cells.x,
+                  [&](int x, int y, int z, int cubeIndex, const glm::vec3*, const float* val) {
+        std::uint32_t edgeVertex[12];
+        uint16_t flags = marching_cubes_cases.edgeFlags[cubeIndex];
+        for (int e = 0; e < 12; ++e) {
+            if (!(flags & (1u << e))) continue;
+            const int8_t* slot = marching_cubes_edge_slots[e];
+            int axis = slot[0];
+            glm::ivec3 lo = begin + glm::ivec3(x + slot[1], y + slot[2], z + slot[3]);
+            std::uint64_t key = edgeKey(global, lo, axis);
+            auto found = byKey.try_emplace(key, static_cast<std::uint32_t>(vertices.size()));
+            if (found.second) {
+                glm::ivec3 hi = lo;
+                ++hi[axis];
+                glm::vec3 p = interpolateVertex(global.point(lo.x, lo.y, lo.z), global.point(hi.x, hi.y, hi.z),
+                                                val[slot[4]], val[slot[5]], job.isovalue);
+                glm::vec3 n = normal(p);
+                vertices.push_back(BrickVertex{key, {p.x, p.y, p.z}, {n.x, n.y, n.z}});
+            }
+            edgeVertex[e] = found.first->second;
+        }
+        const int8_t* triEdges = marching_cubes_lut[cubeIndex];
+        for (int i = 0; i < marching_cubes_cases.triCount[cubeIndex] * 3; ++i)
+            triangles.push_back(edgeVertex[triEdges[i]]);
+    });
+
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Could not write {}", temporary);
+        return false;
+    }
+    BrickFileHeader header;
+    std::memcpy(header.magic, BrickMagic, sizeof(header.magic));
+    header.brick = static_cast<std::uint32_t>(index);
+    header.vertices = static_cast<std::uint32_t>(vertices.size());
+    header.triangles = triangles.size() / 3;
+    bool ok = writeAll(file, &header, sizeof(header)) &&
+              writeAll(file, vertices.data(), vertices.size() * sizeof(BrickVertex)) &&
+              writeAll(file, triangles.data(), triangles.size() * sizeof(std::uint32_t));
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("Could not write {}", path);
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    jobs.add();
+    seconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    LOG_DEBUG("Brick {}: cells ({}, {}, {}) - ({}, {}, {}), {} vertices, {} triangles", index, begin.x, begin.y,
+              begin.z, end.x, end.y, end.z, vertices.size(), triangles.size() / 3);
+    return true;
+}
+
+int run_brick_worker(const std::function<float(float, float, float)>& f, const std::string& dir, int index,
+                     int stride) {
+    BrickJob job;
+    if (!read_brick_job(dir, job)) return 1;
+    if (index < 0 || stride < 1) {
+        LOG_ERROR("Bad worker index {} of {}", index, stride);
+        return 1;
+    }
+    int done = 0;
+    for (int brick = index; brick < job.brickCount(); brick += stride) {
+        std::string path = brick_path(dir, brick);
+        if (fileExists(path)) continue; // Finished by an earlier attempt
+        if (!extract_brick(f, job, brick, path)) return 1;
+        ++done;
+    }
+    LOG_INFO("Worker {} extracted {} bricks", index, done);
+    return 0;
+}
+
+// Vertices are written as they are first seen and triangles are remapped on the fly, into two
+// temporary files that follow the PLY header once the counts are known
+bool stitch_bricks(const BrickJob& job, const std::string& dir, const std::string& plyPath, StitchStats& stats) {
+    MemoryScope scope(MEM_EXPORT);
+    stats = StitchStats();
+    std::string vertexPath = plyPath + ".vertices.tmp", facePath = plyPath + ".faces.tmp";
+    std::FILE* vertexFile = std::fopen(vertexPath.c_str(), "wb");
+    std::FILE* faceFile = std::fopen(facePath.c_str(), "wb");
+    bool ok = vertexFile && faceFile;
+    if (!ok) LOG_ERROR("Could not write next to {}", plyPath);
+
+    std::unordered_map<std::uint64_t, std::uint32_t> seam; // Seam vertices by edge id
+    std::vector<BrickVertex> vertices;
+    std::vector<std::uint32_t> remap, triangles;
+    std::vector<char> faces;
+    for (int brick = 0; ok && brick < job.brickCount(); ++brick) {
+        std::string path = brick_path(dir, brick);
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        BrickFileHeader header;
+        ok = file && readAll(file, &header, sizeof(header)) &&
+             std::memcmp(header.magic, BrickMagic, sizeof(BrickMagic)) == 0 && header.brick == std::uint32_t(brick);
+        if (ok) {
+            vertices.resize(header.vertices);
+            triangles.resize(header.triangles * 3);
+            ok = readAll(file, vertices.data(), vertices.size() * sizeof(BrickVertex)) &&
+                 readAll(file, triangles.data(), triangles.size() * sizeof(std::uint32_t));
+        }
+        if (file) std::fclose(file);
+        if (!ok) {
+            LOG_ERROR("Brick file {} is missing or malformed", path);
+            break;
+        }
+        if (std::any_of(triangles.begin(), triangles.end(), [&](std::uint32_t i) { return i >= header.vertices; })) {
+            LOG_ERROR("Brick file {} has triangle indices past its {} vertices", path, header.vertices);
+            ok = false;
+            break;
+        }
+
+        remap.resize(vertices.size());
+        for (size_t i = 0; ok && i < vertices.size(); ++i) {
+            const BrickVertex& v = vertices[i];
+            std::uint32_t next = static_cast<std::uint32_t>(stats.vertices);
+            if (onSeam(job, v.key)) {
+                auto found = seam.try_emplace(v.key, next);
+                remap[i] = found.first->second;
+                if (!found.second) {
+                    ++stats.weldedVertices;
+                    continue;
+                }
+            } else {
+                remap[i] = next;
+            }
+            ok = writeAll(vertexFile, v.position, sizeof(v.position)) && writeAll(vertexFile, v.normal, sizeof(v.normal));
+            ++stats.vertices;
+        }
+
+        // Faces as PLY list entries: a count byte and three int32 indices
+        faces.resize(header.triangles * 13);
+        for (size_t t = 0; t < header.triangles; ++t) {
+            char* face = &faces[t * 13];
+            face[0] = 3;
+            for (int k = 0; k < 3; ++k) {
+                std::int32_t vertex = static_cast<std::int32_t>(remap[triangles[t * 3 + k]]);
+                std::memcpy(face + 1 + 4 * k, &vertex, 4);
+            }
+        }
+        ok = ok && writeAll(faceFile, faces.data(), faces.size());
+        stats.triangles += header.triangles;
+        ++stats.bricks;
+    }
+    if (vertexFile && std::fclose(vertexFile) != 0) ok = false;
+    if (faceFile && std::fclose(faceFile) != 0) ok = false;
+    if (ok && stats.vertices > static_cast<size_t>(INT32_MAX)) {
+        LOG_ERROR("{} vertices do not fit the int indices of a PLY face list", stats.vertices);
+        ok = false;
+    }
+
+    if (ok) {
+        // Binary PLY in host byte order; the marching kernel already assumes a little-endian host
+        std::FILE* out = std::fopen(plyPath.c_str(), "wb");
+        ok = out != nullptr;
+        if (ok) {
+            std::fprintf(out, "ply\nformat binary_little_endian 1.0\n");
+            std::fprintf(out, "element vertex %zu\n", stats.vertices);
+            std::fprintf(out, "property float x\nproperty float y\nproperty float z\n");
+            std::fprintf(out, "property float nx\nproperty float ny\nproperty float nz\n");
+            std::fprintf(out, "element face %zu\n", stats.triangles);
+            std::fprintf(out, "property list uchar int vertex_indices\nend_header\n");
+            ok = appendFile(out, vertexPath) && appendFile(out, facePath);
+            ok = (std::fclose(out) == 0) && ok;
+        }
+        if (!ok) LOG_ERROR("Could not write {}", plyPath);
+    }
+    std::remove(vertexPath.c_str());
+    std::remove(facePath.c_str());
+    return ok;
+}
+
+bool mesh_distributed(const BrickJob& job, const DistributedOptions& options, const std::string& plyPath) {
+    auto start = std::chrono::steady_clock::now();
+    if (mkdir(options.workDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Could not create {}", options.workDir);
+        return false;
+    }
+    std::string dir = absolutePath(options.workDir); // Workers may start in another directory
+    std::string exe = executablePath();
+    if (exe.empty()) {
+        LOG_ERROR("Could not find the path of the executable to launch workers");
+        return false;
+    }
+
+    // Bricks of an earlier job would be taken as finished
+    int bricks = job.brickCount();
+    for (int brick = 0; brick < bricks; ++brick)
+        std::remove(brick_path(dir, brick).c_str());
+    removePartialBricks(dir);
+    if (!write_brick_job(dir, job)) return false;
+
+    int workers = std::max(1, std::min(options.workers, bricks));
+    glm::ivec3 grid = job.brickGrid();
+    LOG_INFO("Distributed extraction: {} bricks ({} x {} x {}) on {} workers in {}", bricks, grid.x, grid.y, grid.z,
+             workers, dir);
+
+    std::vector<int> indices;
+    for (int i = 0; i < workers; ++i)
+        indices.push_back(i);
+    for (int attempt = 0; attempt < 2 && !indices.empty(); ++attempt) {
+        if (attempt > 0) LOG_WARN("Relaunching {} workers with missing bricks", indices.size());
+        runWorkers(exe, options, dir, indices, workers);
+
+        std::vector<int> missing;
+        for (int i : indices) {
+            for (int brick = i; brick < bricks; brick += workers) {
+                if (!fileExists(brick_path(dir, brick))) {
+                    missing.push_back(i);
+                    break;
+                }
+            }
+        }
+        indices = missing;
+    }
+    removePartialBricks(dir); // Every worker has exited, whether it finished or not
+    if (!indices.empty()) {
+        LOG_ERROR("{} workers did not finish their bricks", indices.size());
+        return false;
+    }
+    double extractSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    StitchStats stats;
+    if (!stitch_bricks(job, dir, plyPath, stats)) return false;
+    if (!options.keepBricks) {
+        for (int brick = 0; brick < bricks; ++brick)
+            std::remove(brick_path(dir, brick).c_str());
+    }
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Wrote {}: {} vertices ({} welded at seams), {} triangles; extraction {} s, total {} s", plyPath,
+             stats.vertices, stats.weldedVertices, stats.triangles, extractSeconds, totalSeconds);
+    return true;
+}
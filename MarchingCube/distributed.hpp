@@ -0,0 +1,119 @@
+// distributed.hpp
+// This header declares the distributed extraction mode: a coordinator splits the lattice into bricks,
+// launches worker processes that extract the bricks and write them to a shared directory, and then
+// stitches the bricks into one indexed mesh. Workers are copies of the same executable started with
+// --brick-worker, either locally or through a launcher command (ssh, srun) on other nodes that see
+// the same filesystem, so a volume too large for one process is meshed with bounded memory per worker.
+//
+// Bricks own disjoint ranges of cells. Neighbouring bricks share the lattice points of their common
+// face (a one-cell overlap of the samples each of them reads), and every vertex is interpolated from
+// the global lattice points of its edge, so both bricks produce bit-identical seam vertices. Each
+// vertex carries the id of its global lattice edge, and the coordinator welds seam vertices by id.
+
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include "marching.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <glm/glm.hpp>
+
+// What every process of a distributed extraction agrees on. The coordinator writes it to the work
+// directory and the workers read it back, so they never depend on their own command line defaults.
+struct BrickJob {
+    float isovalue = 0.0f;
+    Lattice lattice;                  // The whole domain
+    glm::ivec3 brickCells{64, 64, 64}; // Cells per brick along each axis; the last brick of a row may be smaller
+
+    // Returns the number of bricks along each axis
+    glm::ivec3 brickGrid() const;
+
+    // Returns the total number of bricks
+    int brickCount() const;
+
+    // Returns the cell range [begin, end) of brick index (bricks are numbered x fastest)
+    void brickRange(int index, glm::ivec3& begin, glm::ivec3& end) const;
+};
+
+// Options of the coordinator
+struct DistributedOptions {
+    int workers = 4;               // Worker processes; each extracts every workers-th brick
+    std::string workDir = "bricks"; // Job and brick files; must be on a filesystem shared by all nodes
+    std::string launcher;          // Runs the worker command, given as one shell command argument, e.g.
+                                   // "ssh node{}" or "srun -N1 -n1 sh -c" ("{}" is the worker index)
+    bool keepBricks = false;       // Keep the brick files after stitching
+};
+
+// Counts of a stitched mesh
+struct StitchStats {
+    int bricks = 0;
+    size_t vertices = 0;      // Vertices of the stitched mesh
+    size_t weldedVertices = 0; // Brick vertices merged into a neighbour's copy of the same seam vertex
+    size_t triangles = 0;
+};
+
+// Function to write a job description into a work directory.
+// Floats are written in hexadecimal, so every process reads back bit-identical values.
+// Parameters:
+// - dir: The work directory.
+// - job: The job.
+// Returns: False if the file cannot be written.
+bool write_brick_job(const std::string& dir, const BrickJob& job);
+
+// Function to read the job description of a work directory.
+// Parameters:
+// - dir: The work directory.
+// - job: Receives the job.
+// Returns: False if the file is missing or malformed.
+bool read_brick_job(const std::string& dir, BrickJob& job);
+
+// Returns the path of the file of brick index in a work directory.
+std::string brick_path(const std::string& dir, int index);
+
+// Function to extract one brick into a brick file: the vertices (with normals from the field's
+// gradient and their global edge ids) and the triangles as indices into them. The file is written
+// under a temporary name and renamed when complete, so its existence means the brick is done.
+// Parameters:
+// - f: The scalar field.
+// - job: The job.
+// - index: The brick.
+// - path: The output file.
+// Returns: False if the file cannot be written.
+bool extract_brick(const std::function<float(float, float, float)>& f, const BrickJob& job, int index,
+                   const std::string& path);
+
+// Entry point of a worker process: extracts bricks index, index + stride, ... of the job in dir,
+// skipping bricks whose files already exist.
+// Parameters:
+// - f: The scalar field; it must be the one the coordinator was built with.
+// - dir: The work directory.
+// - index, stride: The bricks of this worker.
+// Returns: The process exit code (0 on success).
+int run_brick_worker(const std::function<float(float, float, float)>& f, const std::string& dir, int index,
+                     int stride);
+
+// Function to stitch the brick files of a job into one binary PLY mesh (indexed vertices with
+// normals, and triangles). Bricks are streamed one at a time; only seam vertices are kept in a
+// table until the end, so memory grows with the seam area rather than with the mesh.
+// Parameters:
+// - job: The job.
+// - dir: The work directory holding all brick files.
+// - plyPath: The output file.
+// - stats: Receives the counts.
+// Returns: False if a brick is missing or malformed (including a triangle index past its vertices)
+// or the output cannot be written.
+bool stitch_bricks(const BrickJob& job, const std::string& dir, const std::string& plyPath, StitchStats& stats);
+
+// Function to run a whole distributed extraction as the coordinator: writes the job, launches the
+// workers (re-running the executable with --brick-worker), waits for them, relaunches once the
+// workers whose bricks are missing, and stitches the result. Partial brick files left by workers that
+// were killed mid-write are removed before the launch and once the workers have exited.
+// Parameters:
+// - job: The job.
+// - options: Workers, work directory and launcher.
+// - plyPath: The output file.
+// Returns: False if the extraction failed; the reason is logged.
+bool mesh_distributed(const BrickJob& job, const DistributedOptions& options, const std::string& plyPath);
+
+#endif // DISTRIBUTED_HPP
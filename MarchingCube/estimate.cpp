@@ -0,0 +1,109 @@
+// estimate.cpp
+// This file implements the extraction size estimate declared in estimate.hpp.
+
+#include "estimate.hpp"
+#include "marching.hpp"     // Lattice
+#include "TriTable.hpp" // Lookup table for Marching Cubes edge configurations
+#include <cmath>
+#include <algorithm>
+
+// Sums the bins below v and the share of the bin containing v that lies below it
+float FieldHistogram::fractionBelow(float v) const {
+    size_t total = 0;
+    for (size_t count : bins)
+        total += count;
+    if (total == 0) return 0.0f;
+    if (v <= minValue) return 0.0f;
+    if (v >= maxValue) return 1.0f;
+
+    float position = (v - minValue) / (maxValue - minValue) * bins.size();
+    size_t bin = std::min(static_cast<size_t>(position), bins.size() - 1);
+    double below = 0.0;
+    for (size_t i = 0; i < bin; ++i)
+        below += bins[i];
+    below += bins[bin] * (position - bin);
+    return static_cast<float>(below / total);
+}
+
+// Estimates the output of marching_cubes() from a subsample of its cells.
+ExtractionEstimate estimate_extraction(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    float min,
+    float max,
+    float stepsize,
+    size_t maxSampledCells,
+    int histogramBins
+) {
+    ExtractionEstimate estimate;
+
+    Lattice lattice = make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(stepsize));
+    glm::ivec3 n = lattice.cells;
+    estimate.totalCells = lattice.cellCount();
+
+    // Sample every stride-th cell along each axis, starting in the middle of the first stride
+    int perAxis = std::max(1, static_cast<int>(std::cbrt(static_cast<double>(maxSampledCells))));
+    glm::ivec3 stride = glm::max((n + perAxis - 1) / perAxis, glm::ivec3(1));
+    glm::ivec3 offset = stride / 2;
+
+    std::vector<float> values;
+    size_t active = 0;
+    size_t triangles = 0;
+    for (int x = offset.x; x < n.x; x += stride.x) {
+        for (int y = offset.y; y < n.y; y += stride.y) {
+            for (int z = offset.z; z < n.z; z += stride.z) {
+                int cubeIndex = 0;
+                for (int i = 0; i < 8; ++i) {
+                    glm::vec3 p = lattice.point(x + marching_cubes_corners[i][0],
+                                                y + marching_cubes_corners[i][1],
+                                                z + marching_cubes_corners[i][2]);
+                    float v = f(p.x, p.y, p.z);
+                    values.push_back(v);
+                    if (v < isovalue)
+                        cubeIndex |= (1 << i);
+                }
+                ++estimate.sampledCells;
+                if (marching_cubes_cases.triCount[cubeIndex] > 0) {
+                    ++active;
+                    triangles += marching_cubes_cases.triCount[cubeIndex];
+                }
+            }
+        }
+    }
+
+    // Scale the sampled counts up to the full lattice
+    double scale = static_cast<double>(estimate.totalCells) / std::max<size_t>(estimate.sampledCells, 1);
+    estimate.activeCells = static_cast<size_t>(active * scale + 0.5);
+    estimate.triangles = static_cast<size_t>(triangles * scale + 0.5);
+
+    // 9 floats of positions and 9 floats of normals per triangle; while the vertex vector grows
+    // through push_back it can briefly hold twice its final storage.
+    size_t vertexBytes = estimate.triangles * 9 * sizeof(float);
+    estimate.meshBytes = 2 * vertexBytes;
+    estimate.peakBytes = estimate.meshBytes + vertexBytes;
+
+    // Histogram of the sampled values
+    FieldHistogram& histogram = estimate.histogram;
+    histogram.bins.assign(std::max(histogramBins, 1), 0);
+    if (!values.empty()) {
+        auto range = std::minmax_element(values.begin(), values.end());
+        histogram.minValue = *range.first;
+        histogram.maxValue = *range.second;
+        float width = histogram.maxValue - histogram.minValue;
+        for (float v : values) {
+            size_t bin = width > 0.0f
+                ? static_cast<size_t>((v - histogram.minValue) / width * histogram.bins.size())
+                : 0;
+            ++histogram.bins[std::min(bin, histogram.bins.size() - 1)];
+        }
+    }
+
+    return estimate;
+}
+
+// Suggests a step size whose estimated peak memory fits in a budget.
+float suggest_stepsize(const ExtractionEstimate& estimate, float stepsize, size_t budgetBytes) {
+    if (estimate.peakBytes <= budgetBytes || budgetBytes == 0)
+        return stepsize;
+    return stepsize * std::sqrt(static_cast<float>(estimate.peakBytes) / budgetBytes);
+}
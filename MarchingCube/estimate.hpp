@@ -0,0 +1,66 @@
+// estimate.hpp
+// This header declares a cheap pre-pass that predicts the size of a marching_cubes() result.
+// A sparse subset of cells is sampled to build a histogram of field values and to estimate the
+// number of active cells and triangles, so callers can pick a stepsize, reserve buffers, or refuse
+// jobs that would not fit in memory before running the full extraction.
+
+#ifndef MARCHING_ESTIMATE_HPP
+#define MARCHING_ESTIMATE_HPP
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+// Histogram of the sampled field values.
+struct FieldHistogram {
+    float minValue = 0.0f;     // Smallest sampled value
+    float maxValue = 0.0f;     // Largest sampled value
+    std::vector<size_t> bins;  // Counts of values in equal-width bins over [minValue, maxValue]
+
+    // Returns the lower edge of a bin
+    float binStart(size_t bin) const {
+        return minValue + (maxValue - minValue) * bin / static_cast<float>(bins.size());
+    }
+
+    // Returns the fraction of the sampled values below v, assuming values spread evenly within a bin.
+    // For the isovalue this is the share of the domain inside the surface.
+    float fractionBelow(float v) const;
+};
+
+// Predicted size of a marching_cubes() call.
+struct ExtractionEstimate {
+    size_t totalCells = 0;      // Cells in the full lattice
+    size_t sampledCells = 0;    // Cells actually evaluated by the pre-pass
+    size_t activeCells = 0;     // Estimated number of cells crossing the isosurface
+    size_t triangles = 0;       // Estimated number of triangles
+    size_t meshBytes = 0;       // Estimated size of the vertices and normals returned
+    size_t peakBytes = 0;       // Estimated peak, including push_back growth of the vertex vector
+    FieldHistogram histogram;   // Histogram of the sampled corner values
+};
+
+// Estimates the output of marching_cubes() from a subsample of its cells.
+// Parameters:
+// - f, isovalue, min, max, stepsize: Same as marching_cubes().
+// - maxSampledCells: Upper bound on the number of cells evaluated (8 field calls each).
+// - histogramBins: Number of bins of the value histogram.
+// Returns: The estimate.
+ExtractionEstimate estimate_extraction(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    float min,
+    float max,
+    float stepsize,
+    size_t maxSampledCells = 32768,
+    int histogramBins = 64
+);
+
+// Suggests a step size whose estimated peak memory fits in a budget.
+// Triangle counts scale with the inverse square of the step size.
+// Parameters:
+// - estimate: The estimate computed for stepsize.
+// - stepsize: The step size the estimate was computed for.
+// - budgetBytes: The memory budget.
+// Returns: stepsize if it already fits, otherwise a larger step size.
+float suggest_stepsize(const ExtractionEstimate& estimate, float stepsize, size_t budgetBytes);
+
+#endif // MARCHING_ESTIMATE_HPP
@@ -0,0 +1,109 @@
+// extraction.cpp
+// This file implements the reusable extraction context declared in extraction.hpp.
+
+#include "extraction.hpp"
+#include "marching_kernel.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <chrono>
+
+// Constructor: allocates one workspace per thread and starts the worker threads
+ExtractionContext::ExtractionContext(int numThreads) : numThreads(numThreads) {
+    if (this->numThreads <= 0)
+        this->numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    workspaces.resize(this->numThreads);
+    partial.resize(this->numThreads);
+    for (int t = 1; t < this->numThreads; ++t)
+        workers.emplace_back(&ExtractionContext::worker, this, t);
+}
+
+// Stops and joins the worker threads
+ExtractionContext::~ExtractionContext() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : workers)
+        thread.join();
+}
+
+// Extracts the share of the current job that belongs to one thread: a contiguous range of x-slabs,
+// so that concatenating the outputs in thread order reproduces the single-threaded vertex order
+void ExtractionContext::runSlabs(int index) {
+    int cells = jobLattice.cells.x;
+    int xBegin = static_cast<int>(static_cast<long long>(cells) * index / numThreads);
+    int xEnd = static_cast<int>(static_cast<long long>(cells) * (index + 1) / numThreads);
+    std::vector<float>& out = (index == 0) ? vertexBuffer : partial[index];
+    out.clear(); // Keeps the capacity
+    if (xBegin < xEnd)
+        march_triangles(jobLattice, *jobField, jobIsovalue, workspaces[index], xBegin, xEnd, out);
+    LOG_DEBUG("Slabs {}-{} on thread {}: {} triangles", xBegin, xEnd, index, out.size() / 9);
+}
+
+// Worker loop: waits for a job, runs its slabs and reports completion
+void ExtractionContext::worker(int index) {
+    MemoryScope scope(MEM_MESHING);
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        runSlabs(index);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) done.notify_one();
+        }
+    }
+}
+
+// Extracts the isosurface, splitting the lattice into x-slabs across the threads
+const std::vector<float>& ExtractionContext::extract(const std::function<float(float, float, float)>& f,
+                                                     float isovalue, const Lattice& lattice) {
+    static Counter& jobs = metrics_counter("marching_meshing_jobs_total", "Meshing jobs run", "engine=\"context\"");
+    static Histogram& seconds = metrics_histogram("marching_meshing_seconds", "Duration of meshing jobs",
+                                                  {0.001, 0.01, 0.1, 0.5, 1, 5, 30, 120}, "engine=\"context\"");
+    auto start = std::chrono::steady_clock::now();
+    MemoryScope scope(MEM_MESHING);
+    jobField = &f;
+    jobIsovalue = isovalue;
+    jobLattice = lattice;
+
+    if (numThreads > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = numThreads - 1;
+            ++generation;
+        }
+        wake.notify_all();
+    }
+
+    runSlabs(0);
+
+    if (numThreads > 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return pending == 0; });
+        for (int t = 1; t < numThreads; ++t)
+            vertexBuffer.insert(vertexBuffer.end(), partial[t].begin(), partial[t].end());
+    }
+    jobs.add();
+    seconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return vertexBuffer;
+}
+
+// Extracts the isosurface over [min, max] in every axis
+const std::vector<float>& ExtractionContext::extract(const std::function<float(float, float, float)>& f,
+                                                     float isovalue, float min, float max, float stepsize) {
+    return extract(f, isovalue, make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(stepsize)));
+}
+
+// Computes the normals of the last mesh into the reused normal buffer
+const std::vector<float>& ExtractionContext::computeNormals() {
+    compute_normals(vertexBuffer, normalBuffer);
+    return normalBuffer;
+}
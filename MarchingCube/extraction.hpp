@@ -0,0 +1,79 @@
+// extraction.hpp
+// This header declares ExtractionContext, a reusable workspace for repeated Marching Cubes extractions
+// (animation, interactive isovalue changes). The context owns the sample slices, edge caches and
+// output buffers and only ever grows them, so once it has seen a mesh of a given size, extracting
+// again and recomputing the normals performs no heap allocations. Parallel runs use a persistent
+// pool of worker threads, each with its own workspace and output buffer.
+
+#ifndef EXTRACTION_CONTEXT_HPP
+#define EXTRACTION_CONTEXT_HPP
+
+#include "marching.hpp"
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct MarchingWorkspace;
+
+class ExtractionContext {
+public:
+    // Constructor
+    // Parameters:
+    // - numThreads: Number of threads used per extraction, including the calling thread
+    //   (0 = hardware concurrency). The extra threads are started once and kept until destruction.
+    explicit ExtractionContext(int numThreads = 1);
+    ~ExtractionContext();
+
+    ExtractionContext(const ExtractionContext&) = delete;
+    ExtractionContext& operator=(const ExtractionContext&) = delete;
+
+    // Extracts the isosurface into the context's vertex buffer.
+    // The output is the same as marching_cubes() for any number of threads.
+    // Parameters:
+    // - f: Scalar field; it is called concurrently from all threads, so it must be thread-safe.
+    // - isovalue: The isosurface value.
+    // - lattice: The sampling lattice.
+    // Returns: The vertices, valid until the next call.
+    const std::vector<float>& extract(const std::function<float(float, float, float)>& f,
+                                      float isovalue, const Lattice& lattice);
+
+    // Same as above over [min, max] in every axis.
+    const std::vector<float>& extract(const std::function<float(float, float, float)>& f,
+                                      float isovalue, float min, float max, float stepsize);
+
+    // Computes flat normals of the last extracted mesh into the context's normal buffer.
+    // Returns: The normals, valid until the next call.
+    const std::vector<float>& computeNormals();
+
+    // Returns the last extracted vertices and computed normals.
+    const std::vector<float>& vertices() const { return vertexBuffer; }
+    const std::vector<float>& normals() const { return normalBuffer; }
+
+    // Returns the number of threads used per extraction.
+    int threadCount() const { return numThreads; }
+
+private:
+    void runSlabs(int index);
+    void worker(int index);
+
+    int numThreads;
+    std::vector<MarchingWorkspace> workspaces; // One per thread
+    std::vector<std::vector<float>> partial;   // Output of threads 1..n-1 (thread 0 writes vertexBuffer)
+    std::vector<float> vertexBuffer, normalBuffer;
+
+    // Current job, read by the workers between wake-up and completion
+    const std::function<float(float, float, float)>* jobField = nullptr;
+    float jobIsovalue = 0.0f;
+    Lattice jobLattice;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;                 // Guards generation, pending and stopping
+    std::condition_variable wake, done;
+    unsigned generation = 0;          // Incremented for every job
+    int pending = 0;                  // Workers still running the current job
+    bool stopping = false;
+};
+
+#endif // EXTRACTION_CONTEXT_HPP
@@ -0,0 +1,7 @@
+// field.glsl
+// GLSL version of the scalar function extracted by main.cpp.
+// Included by the GPU marching cubes kernels; keep it in sync with scalarFunction in main.cpp.
+
+float field(vec3 p) {
+    return cos(p.x * 2.0) - sin(p.y * 2.0) - sin(p.z * 2.0);
+}
@@ -2,6 +2,7 @@
 
 in vec3 FragPos;
 in vec3 Normal;
+in vec2 TexCoord;
 
 out vec4 FragColor;
 
@@ -9,13 +10,19 @@ uniform vec3 lightDir = normalize(vec3(-1.0, -1.0, -1.0));
 uniform vec3 viewPos = vec3(0.0, 0.0, 5.0);
 uniform vec3 objectColor = vec3(0.2, 0.6, 1.0);
 
+// Object-space normal map baked from the field (see normal_bake.hpp)
+uniform bool useNormalMap = false;
+uniform sampler2D normalMap;
+uniform mat3 normalMatrix = mat3(1.0); // transpose(inverse(mat3(model)))
+
 void main() {
     // Ambient
     float ambientStrength = 0.2;
     vec3 ambient = ambientStrength * objectColor;
 
     // Diffuse
-    vec3 norm = normalize(Normal);
+    vec3 norm = useNormalMap ? normalize(normalMatrix * (texture(normalMap, TexCoord).rgb * 2.0 - 1.0))
+                             : normalize(Normal);
     float diff = max(dot(norm, -lightDir), 0.0);
     vec3 diffuse = diff * objectColor;
 
@@ -0,0 +1,103 @@
+// generator.hpp
+// A minimal C++20 coroutine generator: a coroutine returning Generator<T> runs until its next
+// co_yield each time the consumer pulls a value, and is destroyed (with everything it owns) as
+// soon as the Generator goes out of scope, so consumers can stop early at no extra cost.
+//
+//     for (const T& value : someGenerator()) { ... }
+//
+// Yielded values are passed by reference and live until the next pull. Exceptions thrown by the
+// coroutine are rethrown to the consumer.
+
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        const T* current = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; } // Lazy: nothing runs until the first pull
+        std::suspend_always final_suspend() noexcept { return {}; }
+        // The yielded object (even a temporary) lives until the coroutine resumes
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = std::addressof(value);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+        template <typename U> void await_transform(U&&) = delete; // co_await is not supported
+    };
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+        using reference = const T&;
+        using pointer = const T*;
+
+        iterator() = default;
+        explicit iterator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+        reference operator*() const { return *handle.promise().current; }
+        pointer operator->() const { return handle.promise().current; }
+        iterator& operator++() {
+            resume(handle);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) { return !it.handle || it.handle.done(); }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle) handle.destroy();
+    }
+
+    // Runs the coroutine up to its first co_yield. A generator can only be iterated once.
+    iterator begin() {
+        resume(handle);
+        return iterator(handle);
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    // Resumes the coroutine and rethrows what it threw
+    static void resume(std::coroutine_handle<promise_type> handle) {
+        if (!handle || handle.done()) return;
+        handle.resume();
+        if (handle.promise().exception)
+            std::rethrow_exception(std::exchange(handle.promise().exception, nullptr));
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+#endif // GENERATOR_HPP
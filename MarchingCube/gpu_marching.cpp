@@ -0,0 +1,257 @@
+// gpu_marching.cpp
+// This file implements the compute-shader Marching Cubes engine declared in gpu_marching.hpp.
+
+#include "gpu_marching.hpp"
+#include "marching.hpp"  // make_lattice()
+#include "TriTable.hpp" // Lookup table for Marching Cubes edge configurations
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "log.hpp"
+#include "memory.hpp"
+#include "metrics.hpp"
+
+// Reads a file into a string
+static std::string readFile(const char* path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Could not open {}", path);
+        return "";
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Compiles and links a compute program from the field source and a kernel file
+static GLuint loadComputeProgram(const std::string& fieldSource, const char* kernelPath) {
+    std::string code = "#version 430 core\n" + fieldSource + "\n" + readFile(kernelPath);
+    const char* source = code.c_str();
+
+    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        LOG_ERROR("Compute shader compilation failed ({}):\n{}", kernelPath, infoLog);
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        LOG_ERROR("Compute program linking failed ({}):\n{}", kernelPath, infoLog);
+    }
+
+    glDeleteShader(shader);
+    return program;
+}
+
+// Dispatches enough 64-wide groups to cover the given number of invocations.
+// Large counts are split over a second dimension to stay under the 65535 group limit.
+static void dispatch1D(size_t invocations) {
+    GLuint groups = static_cast<GLuint>((invocations + 63) / 64);
+    if (groups == 0) return;
+    GLuint groupsX = std::min<GLuint>(groups, 65535);
+    GLuint groupsY = (groups + groupsX - 1) / groupsX;
+    glDispatchCompute(groupsX, groupsY, 1);
+}
+
+// Constructor: compiles the kernels and uploads the lookup tables.
+GpuMarchingCubes::GpuMarchingCubes(const char* fieldPath, size_t maxTriangles)
+    : maxTriangles(maxTriangles) {
+    std::string fieldSource = readFile(fieldPath);
+    classifyProgram = loadComputeProgram(fieldSource, "marching_classify.comp");
+    reduceProgram = loadComputeProgram(fieldSource, "marching_reduce.comp");
+    generateProgram = loadComputeProgram(fieldSource, "marching_generate.comp");
+
+    // The kernels index plain int arrays, so the byte tables are widened for upload
+    GLint triTable[256][16];
+    GLuint triCounts[256];
+    for (int i = 0; i < 256; ++i) {
+        for (int j = 0; j < 16; ++j)
+            triTable[i][j] = marching_cubes_lut[i][j];
+        triCounts[i] = marching_cubes_cases.triCount[i];
+    }
+
+    glGenBuffers(1, &triTableBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triTableBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(triTable), triTable, GL_STATIC_DRAW);
+    memory_track_gl(MEM_GPU_BUFFERS, triTableBuffer, sizeof(triTable));
+
+    glGenBuffers(1, &triCountBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triCountBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(triCounts), triCounts, GL_STATIC_DRAW);
+    memory_track_gl(MEM_GPU_BUFFERS, triCountBuffer, sizeof(triCounts));
+
+    glGenBuffers(1, &pyramidBuffer);
+
+    // Indirect commands: DrawArraysIndirectCommand (4 uints) followed by DispatchIndirectCommand (3 uints),
+    // then the triangle count before clamping to maxTriangles
+    const GLuint emptyCommands[8] = {0, 1, 0, 0, 0, 0, 1, 0};
+    glGenBuffers(1, &indirectBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indirectBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(emptyCommands), emptyCommands, GL_DYNAMIC_DRAW);
+    memory_track_gl(MEM_GPU_BUFFERS, indirectBuffer, sizeof(emptyCommands));
+
+    // Interleaved position + normal, 6 floats per vertex
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxTriangles * 3 * 6 * sizeof(float), NULL, GL_DYNAMIC_COPY);
+    memory_track_gl(MEM_GPU_BUFFERS, vertexBuffer, maxTriangles * 3 * 6 * sizeof(float));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);                   // layout(location = 0)
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float))); // layout(location = 1)
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+}
+
+// Destructor: releases all GL objects
+GpuMarchingCubes::~GpuMarchingCubes() {
+    glDeleteVertexArrays(1, &vao);
+    GLuint buffers[5] = {triTableBuffer, triCountBuffer, pyramidBuffer, vertexBuffer, indirectBuffer};
+    memory_release_gl(MEM_GPU_BUFFERS, 5, buffers);
+    glDeleteBuffers(5, buffers);
+    glDeleteProgram(classifyProgram);
+    glDeleteProgram(reduceProgram);
+    glDeleteProgram(generateProgram);
+}
+
+// Extracts the isosurface: classify, build the HistoPyramid, then generate triangles.
+// Only the jobs are counted: their duration is GPU time, which the CPU side never waits for.
+void GpuMarchingCubes::extract(float isovalue, float min, float max, float stepsize) {
+    static Counter& jobs = metrics_counter("marching_meshing_jobs_total", "Meshing jobs run", "engine=\"gpu\"");
+    jobs.add();
+    GLuint n = static_cast<GLuint>(make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(stepsize)).cells.x);
+    size_t numCells = static_cast<size_t>(n) * n * n;
+
+    // Pyramid layout: level 0 holds one count per cell, every further level a quarter of the previous
+    GLuint levelOffsets[16] = {0};
+    GLuint levelSizes[16] = {0};
+    int numLevels = 0;
+    size_t total = 0;
+    size_t size = numCells;
+    do {
+        levelOffsets[numLevels] = static_cast<GLuint>(total);
+        levelSizes[numLevels] = static_cast<GLuint>(size);
+        total += size;
+        ++numLevels;
+        size = (size + 3) / 4;
+    } while ((levelSizes[numLevels - 1] > 1 || numLevels < 2) && numLevels < 16);
+    if (levelSizes[numLevels - 1] > 1) {
+        LOG_ERROR("Lattice too large for the GPU marching cubes pyramid");
+        return;
+    }
+
+    if (total > pyramidCapacity) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pyramidBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, total * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+        memory_track_gl(MEM_GPU_BUFFERS, pyramidBuffer, total * sizeof(GLuint));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        pyramidCapacity = total;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, triTableBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, triCountBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, pyramidBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, vertexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, indirectBuffer);
+
+    // Pass 1: classify cells into the pyramid base
+    glUseProgram(classifyProgram);
+    glUniform3f(glGetUniformLocation(classifyProgram, "gridMin"), min, min, min);
+    glUniform1f(glGetUniformLocation(classifyProgram, "stepSize"), stepsize);
+    glUniform1ui(glGetUniformLocation(classifyProgram, "cellsPerAxis"), n);
+    glUniform1f(glGetUniformLocation(classifyProgram, "isovalue"), isovalue);
+    dispatch1D(numCells);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Pass 2: reduce level by level; the top level also writes the indirect commands
+    glUseProgram(reduceProgram);
+    glUniform1ui(glGetUniformLocation(reduceProgram, "maxTriangles"), static_cast<GLuint>(maxTriangles));
+    for (int level = 1; level < numLevels; ++level) {
+        glUniform1ui(glGetUniformLocation(reduceProgram, "srcOffset"), levelOffsets[level - 1]);
+        glUniform1ui(glGetUniformLocation(reduceProgram, "srcSize"), levelSizes[level - 1]);
+        glUniform1ui(glGetUniformLocation(reduceProgram, "dstOffset"), levelOffsets[level]);
+        glUniform1ui(glGetUniformLocation(reduceProgram, "dstSize"), levelSizes[level]);
+        dispatch1D(levelSizes[level]);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    // Pass 3: one invocation per output triangle, sized on the GPU through the indirect buffer
+    glUseProgram(generateProgram);
+    glUniform3f(glGetUniformLocation(generateProgram, "gridMin"), min, min, min);
+    glUniform1f(glGetUniformLocation(generateProgram, "stepSize"), stepsize);
+    glUniform1ui(glGetUniformLocation(generateProgram, "cellsPerAxis"), n);
+    glUniform1f(glGetUniformLocation(generateProgram, "isovalue"), isovalue);
+    glUniform1uiv(glGetUniformLocation(generateProgram, "levelOffsets"), numLevels, levelOffsets);
+    glUniform1uiv(glGetUniformLocation(generateProgram, "levelSizes"), numLevels, levelSizes);
+    glUniform1i(glGetUniformLocation(generateProgram, "numLevels"), numLevels);
+    glUniform1ui(glGetUniformLocation(generateProgram, "maxTriangles"), static_cast<GLuint>(maxTriangles));
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirectBuffer);
+    glDispatchComputeIndirect(4 * sizeof(GLuint));
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glUseProgram(0);
+}
+
+// Draws the last extracted mesh with the triangle count written by the GPU
+void GpuMarchingCubes::draw() const {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glDrawArraysIndirect(GL_TRIANGLES, (void*)0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+// Reads the triangle count back from the indirect draw command
+size_t GpuMarchingCubes::readTriangleCount() const {
+    GLuint vertexCount = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indirectBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &vertexCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return vertexCount / 3;
+}
+
+// Reads the unclamped triangle count back and warns if the vertex buffer was too small for it
+bool GpuMarchingCubes::truncated() const {
+    GLuint required = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, indirectBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 7 * sizeof(GLuint), sizeof(GLuint), &required);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    if (required <= maxTriangles) return false;
+    LOG_WARN("GPU mesh truncated: the surface has {} triangles but the vertex buffer holds {}", required, maxTriangles);
+    return true;
+}
+
+// Reads the vertex buffer back, de-interleaving positions and normals
+void GpuMarchingCubes::readMesh(std::vector<float>& vertices, std::vector<float>& normals) const {
+    size_t numVertices = readTriangleCount() * 3;
+    std::vector<float> interleaved(numVertices * 6);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, interleaved.size() * sizeof(float), interleaved.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    vertices.resize(numVertices * 3);
+    normals.resize(numVertices * 3);
+    for (size_t i = 0; i < numVertices; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            vertices[i * 3 + j] = interleaved[i * 6 + j];
+            normals[i * 3 + j] = interleaved[i * 6 + 3 + j];
+        }
+    }
+}
@@ -0,0 +1,55 @@
+// gpu_marching.hpp
+// This header declares an OpenGL 4.3 compute-shader implementation of Marching Cubes.
+// The field is written in GLSL (see field.glsl); cells are classified on the GPU, active cells are
+// compacted with a HistoPyramid, and the triangles are written into a vertex buffer that is drawn
+// with an indirect draw call, so the mesh never travels back to the CPU.
+
+#ifndef GPU_MARCHING_HPP
+#define GPU_MARCHING_HPP
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstddef>
+
+class GpuMarchingCubes {
+public:
+    // Constructor
+    // Compiles the compute kernels against the given field and allocates the vertex buffer.
+    // Requires a current OpenGL 4.3 context.
+    // Parameters:
+    // - fieldPath: Path to a GLSL file defining float field(vec3 p).
+    // - maxTriangles: Capacity of the vertex buffer; extra triangles are dropped (see truncated()).
+    GpuMarchingCubes(const char* fieldPath, size_t maxTriangles);
+    ~GpuMarchingCubes();
+
+    GpuMarchingCubes(const GpuMarchingCubes&) = delete;
+    GpuMarchingCubes& operator=(const GpuMarchingCubes&) = delete;
+
+    // Extracts the isosurface on the GPU. Same parameters as marching_cubes().
+    void extract(float isovalue, float min, float max, float stepsize);
+
+    // Draws the last extracted mesh (positions at location 0, normals at location 1).
+    void draw() const;
+
+    // Reads the triangle count back from the GPU. Only meant for diagnostics and tests;
+    // drawing never needs it.
+    size_t readTriangleCount() const;
+
+    // Returns true (and logs a warning) if the last extraction produced more triangles than the
+    // vertex buffer holds, so that only the first maxTriangles are drawn. Reads one value back from
+    // the GPU, so call it once after extract() rather than every frame.
+    bool truncated() const;
+
+    // Reads the vertex buffer back in the layout of marching_cubes() and compute_normals().
+    // Only meant for comparing against the CPU engine.
+    void readMesh(std::vector<float>& vertices, std::vector<float>& normals) const;
+
+private:
+    GLuint classifyProgram, reduceProgram, generateProgram;
+    GLuint triTableBuffer, triCountBuffer, pyramidBuffer, vertexBuffer, indirectBuffer;
+    GLuint vao;
+    size_t maxTriangles;
+    size_t pyramidCapacity = 0; // Number of uints allocated in pyramidBuffer
+};
+
+#endif // GPU_MARCHING_HPP
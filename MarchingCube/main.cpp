@@ -8,10 +8,25 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "Camera.hpp"
 #include "marching.hpp"
+#include "gpu_marching.hpp"
+#include "estimate.hpp"
+#include "progressive.hpp"
+#include "surface_stats.hpp"
+#include "normal_bake.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+#include "metrics.hpp"
+#include "distributed.hpp"
+#include "gl_loader.hpp"
 #include <fstream>     // For file reading
 #include <sstream>     // For string manipulation
 #include <string>      // For std::string
-#include <iostream>    // For console output
+#include <cstdlib>     // For atof
+#include <future>      // For the startup tasks
+#include <chrono>
+#include <atomic>
+#include <ctime>       // For the CPU time report
+#include <memory>      // For the metrics exporter
 
 // Global variables for camera and mouse interaction
 Camera camera;               // Camera object
@@ -19,6 +34,17 @@ bool mousePressed = false;   // Tracks if the left mouse button is pressed
 double lastX = 0.0, lastY = 0.0; // Last mouse position
 bool firstMouse = true;      // Tracks if this is the first mouse movement
 GLuint VAO, VBO[2];          // Vertex Array Object and Vertex Buffer Objects
+bool raymarchView = false;   // Draw the field by raymarching instead of the extracted mesh
+float traceIsovalue = -1.5f; // Isovalue used by the raymarched view (adjustable at runtime)
+bool redraw = true;          // Something on screen changed since the last frame (on-demand mode)
+std::atomic<bool> wakeEnabled(false); // GLFW is up and not shutting down, so worker threads may post events
+
+// Wakes the render loop from glfwWaitEvents; safe to call from any thread, does nothing before GLFW is
+// up or once shutdown has begun
+void wakeRenderLoop() {
+    if (wakeEnabled)
+        glfwPostEmptyEvent();
+}
 
 // Callback for mouse button events
 // Tracks when the left mouse button is pressed or released
@@ -47,16 +73,44 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
     lastY = ypos;
 
     camera.processMouseMovement(xoffset, yoffset); // Update camera orientation
+    redraw = true;
 }
 
 // Callback for scroll events
 // Updates the camera's zoom level based on scroll input
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     camera.processMouseScroll((float)yoffset);
+    redraw = true;
+}
+
+// Callback for keyboard events
+// R switches between the mesh view and the raymarched view; +/- change the raymarched isovalue;
+// M logs the memory used so far
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (action == GLFW_RELEASE) return;
+    if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        memory_report();
+        return;
+    }
+    if (key == GLFW_KEY_R && action == GLFW_PRESS)
+        raymarchView = !raymarchView;
+    if (key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD)
+        traceIsovalue += 0.05f;
+    if (key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT)
+        traceIsovalue -= 0.05f;
+    redraw = true;
+}
+
+// Callback for window refresh events (exposed, resized, restored)
+void window_refresh_callback(GLFWwindow* window) {
+    redraw = true;
 }
 
-// Function to load and compile shaders from files
-GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
+// Function to start compiling and linking shaders from files
+// If includePath is given, that file is inserted after the #version line of the fragment shader.
+// Errors are reported by checkShaders, so several programs can compile at once (on driver threads
+// with GL_KHR_parallel_shader_compile) while the application does other work.
+GLuint startShaders(const char* vertexPath, const char* fragmentPath, const char* includePath = nullptr) {
     // Helper lambda to read a file into a string
     auto readFile = [](const char* path) -> std::string {
         std::ifstream file(path);
@@ -68,6 +122,10 @@ GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
     // Read shader source code
     std::string vertexCode = readFile(vertexPath);
     std::string fragmentCode = readFile(fragmentPath);
+    if (includePath) {
+        size_t lineEnd = fragmentCode.find('\n') + 1;
+        fragmentCode.insert(lineEnd, readFile(includePath) + "\n");
+    }
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
@@ -75,75 +133,283 @@ GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexShader, 1, &vShaderCode, NULL);
     glCompileShader(vertexShader);
-    GLint success;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cerr << "Vertex shader compilation failed:\n" << infoLog << std::endl;
-    }
 
     // Compile fragment shader
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
     glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cerr << "Fragment shader compilation failed:\n" << infoLog << std::endl;
-    }
 
-    // Link shaders into a program
+    // Link shaders into a program; they stay attached until checkShaders reads their logs
     GLuint shaderProgram = glCreateProgram();
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
     glLinkProgram(shaderProgram);
+    return shaderProgram;
+}
+
+// Function to report compile and link errors of a program from startShaders and delete its shaders
+void checkShaders(GLuint shaderProgram) {
+    GLuint shaders[2];
+    GLsizei count = 0;
+    glGetAttachedShaders(shaderProgram, 2, &count, shaders);
+
+    GLint success;
+    for (GLsizei i = 0; i < count; ++i) {
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+        if (!success) {
+            GLint type;
+            char infoLog[512];
+            glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+            glGetShaderInfoLog(shaders[i], 512, NULL, infoLog);
+            LOG_ERROR("{} shader compilation failed:\n{}", type == GL_VERTEX_SHADER ? "Vertex" : "Fragment", infoLog);
+        }
+    }
+
     glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
     if (!success) {
         char infoLog[512];
         glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "Shader program linking failed:\n" << infoLog << std::endl;
+        LOG_ERROR("Shader program linking failed:\n{}", infoLog);
     }
 
     // Clean up shaders (no longer needed after linking)
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    for (GLsizei i = 0; i < count; ++i) {
+        glDetachShader(shaderProgram, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
+}
 
-    return shaderProgram;
+// Returns true if a startup task has finished, without blocking
+template <typename T>
+bool isReady(const std::shared_future<T>& task) {
+    return task.valid() && task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+// Bytes sent to GL buffers and textures, for the metrics export
+Counter& uploadBytes = metrics_counter("marching_upload_bytes_total", "Bytes uploaded to GL buffers and textures");
+
+// Fills a vertex buffer and a normal buffer with a mesh; runs on the loader thread
+void fillMeshBuffers(const GLuint vbo[2], const std::vector<float>& vertices, const std::vector<float>& normals) {
+    uploadBytes.add((vertices.size() + normals.size()) * sizeof(float));
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    memory_track_gl(MEM_GPU_BUFFERS, vbo[0], vertices.size() * sizeof(float));
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
+    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
+    memory_track_gl(MEM_GPU_BUFFERS, vbo[1], normals.size() * sizeof(float));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-int main() {
+// Points a VAO at buffers filled by fillMeshBuffers, with positions at location 0 and normals at location 1
+void bindMeshBuffers(GLuint vao, const GLuint vbo[2]) {
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // layout(location = 0)
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // layout(location = 1)
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0); // Unbind VAO
+}
+
+// GL objects of one region of a progressive extraction
+struct RegionBuffers {
+    GLuint vao = 0;
+    GLuint vbo[2] = {0, 0}; // Buffers of the mesh drawn now; each upload fills new ones
+    GLsizei count = 0;      // Number of vertices
+    bool fine = false;      // True once the full-resolution mesh was sent to the loader
+};
+
+// A region mesh on its way to the GPU
+struct RegionUpload {
+    RegionMesh mesh;
+    GLuint vbo[2] = {0, 0};
+};
+
+int main(int argc, char* argv[]) {
+    // Command line options
+    bool useGpu = false; // --gpu: extract on the GPU with compute shaders (OpenGL 4.3)
+    bool estimateOnly = false;
+    bool statsOnly = false;
+    bool bake = false; // --bake: coarse mesh shaded with a normal map baked from the field
+    double budgetMB = 0.0;
+    bool progressive = false; // --progressive: show a coarse preview at once, refine region by region
+    bool continuous = false; // --continuous: redraw every frame (benchmarks) instead of only on changes
+    bool memoryReport = false; // --memory: log current and peak memory per subsystem on exit
+    std::string metricsFile;   // --metrics-file: write Prometheus metrics to this file periodically
+    int metricsPort = 0;       // --metrics-port: serve Prometheus metrics on 127.0.0.1:port
+    double metricsInterval = 10.0;
+    float stepOverride = 0.0f;     // --step: sampling step size (default 0.2)
+    DistributedOptions distributed; // --distributed N: extract in N worker processes into output.ply and exit
+    int distributedWorkers = 0;
+    int brickCells = 64;           // --brick-cells: cells per brick edge in distributed mode
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--gpu") useGpu = true;
+        if (arg == "--raymarch") raymarchView = true; // start in the raymarched view
+        if (arg == "--estimate") estimateOnly = true;   // print the size estimate and exit
+        if (arg == "--progressive") progressive = true;
+        if (arg == "--stats") statsOnly = true;         // print area, volume and bounds and exit
+        if (arg == "--bake") bake = true;
+        if (arg == "--continuous") continuous = true;
+        if (arg == "--memory") memoryReport = true;
+        if (arg == "--metrics-file" && i + 1 < argc) metricsFile = argv[++i];
+        if (arg == "--metrics-port" && i + 1 < argc) metricsPort = atoi(argv[++i]);
+        if (arg == "--metrics-interval" && i + 1 < argc) metricsInterval = atof(argv[++i]); // seconds between file writes
+        if (arg == "--budget-mb" && i + 1 < argc) budgetMB = atof(argv[++i]); // refuse larger jobs
+        if (arg == "--step" && i + 1 < argc) stepOverride = static_cast<float>(atof(argv[++i]));
+        if (arg == "--distributed" && i + 1 < argc) distributedWorkers = atoi(argv[++i]);
+        if (arg == "--brick-cells" && i + 1 < argc) brickCells = atoi(argv[++i]);
+        if (arg == "--work-dir" && i + 1 < argc) distributed.workDir = argv[++i]; // shared by all nodes
+        if (arg == "--launcher" && i + 1 < argc) distributed.launcher = argv[++i]; // e.g. "ssh node{}"
+        if (arg == "--keep-bricks") distributed.keepBricks = true;
+    }
+
+    // Define scalar function for marching cubes
+    auto scalarFunction = [](float x, float y, float z) {
+        return cos(x * 2) - sin(y * 2) - sin(z * 2);
+    };
+
+    // A worker of a distributed extraction (launched by the coordinator below): the job comes from
+    // the work directory, not from the other options
+    for (int i = 1; i + 3 < argc; ++i) {
+        if (std::string(argv[i]) == "--brick-worker")
+            return run_brick_worker(scalarFunction, argv[i + 1], atoi(argv[i + 2]), atoi(argv[i + 3]));
+    }
+
+    float isovalue = -1.5f; // Isovalue for the scalar field
+    float min = -5.0f;      // Minimum bounds for the field
+    float max = 5.0f;       // Maximum bounds for the field
+    float step = stepOverride > 0.0f ? stepOverride : 0.2f; // Step size for sampling
+    traceIsovalue = isovalue;
+
+    // Extract in worker processes, brick by brick, and stitch the bricks into output.ply
+    if (distributedWorkers > 0) {
+        BrickJob job;
+        job.isovalue = isovalue;
+        job.lattice = make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(step));
+        job.brickCells = glm::max(glm::ivec3(brickCells), glm::ivec3(1));
+        distributed.workers = distributedWorkers;
+        return mesh_distributed(job, distributed, "output.ply") ? 0 : 1;
+    }
+
+    // Predict the output size before committing to the extraction
+    if (estimateOnly || budgetMB > 0.0) {
+        ExtractionEstimate estimate = estimate_extraction(scalarFunction, isovalue, min, max, step);
+        size_t budgetBytes = static_cast<size_t>(budgetMB * 1024.0 * 1024.0);
+        LOG_INFO("Estimated {} active cells of {}, {} triangles, {} MB peak (sampled {} cells)",
+                 estimate.activeCells, estimate.totalCells, estimate.triangles,
+                 estimate.peakBytes / (1024.0 * 1024.0), estimate.sampledCells);
+        LOG_INFO("Sampled field values in [{}, {}]; {}% below the isovalue {}",
+                 estimate.histogram.minValue, estimate.histogram.maxValue,
+                 100.0f * estimate.histogram.fractionBelow(isovalue), isovalue);
+        if (budgetBytes > 0 && estimate.peakBytes > budgetBytes) {
+            LOG_ERROR("Estimated extraction exceeds the {} MB budget; try a step size of {} or more",
+                      budgetMB, suggest_stepsize(estimate, step, budgetBytes));
+            return 1;
+        }
+        if (estimateOnly) return 0;
+    }
+
+    // Measure the surface without building the mesh
+    if (statsOnly) {
+        SurfaceStats stats = surface_stats(scalarFunction, isovalue, min, max, step);
+        LOG_INFO("{} triangles, area {}, volume {}, bounds ({}, {}, {}) - ({}, {}, {})",
+                 stats.triangles, stats.area, stats.volume, stats.boundsMin.x, stats.boundsMin.y, stats.boundsMin.z,
+                 stats.boundsMax.x, stats.boundsMax.y, stats.boundsMax.z);
+        return 0;
+    }
+
+    // Session metrics, recorded always and exported only on request. Memory is sampled per export.
+    Histogram& frameSeconds = metrics_histogram("marching_frame_seconds", "Time to draw and swap a frame",
+                                                {0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066, 0.125, 0.25, 1});
+    Counter& framesDrawn = metrics_counter("marching_frames_total", "Frames drawn");
+    Gauge& trianglesDrawn = metrics_gauge("marching_triangles_drawn", "Mesh triangles drawn in the last frame");
+    Counter& trianglesDrawnTotal = metrics_counter("marching_triangles_drawn_total", "Mesh triangles drawn");
+    std::unique_ptr<MetricsExporter> exporter;
+    if (!metricsFile.empty() || metricsPort > 0) {
+        metrics_on_collect([]() {
+            for (int tag = 0; tag < MEM_TAG_COUNT; ++tag) {
+                std::string label = std::string("tag=\"") + memory_tag_name(static_cast<MemoryTag>(tag)) + "\"";
+                MemoryUsage usage = memory_usage(static_cast<MemoryTag>(tag));
+                metrics_gauge("marching_memory_bytes", "Memory in use per subsystem", label).set(usage.current);
+                metrics_gauge("marching_memory_peak_bytes", "Peak memory per subsystem", label).set(usage.peak);
+            }
+        });
+        exporter = std::make_unique<MetricsExporter>(metricsFile, metricsPort, metricsInterval);
+    }
+
+    // Startup tasks: extraction, normals, the normal-map bake and the .ply export run on worker
+    // threads while the window, context and shaders are created, and the render loop picks their
+    // results up as they finish. With --bake the mesh is extracted at a few times the step size and
+    // the detail goes into a normal map.
+    std::vector<float> vertices, normals;
+    NormalMap map;
+    std::shared_future<void> meshTask, bakeTask, plyTask;
+    if (!useGpu && !progressive) {
+        meshTask = std::async(std::launch::async, [&]() {
+            vertices = marching_cubes(scalarFunction, isovalue, min, max, bake ? step * 4.0f : step);
+            normals = compute_normals(vertices);
+            wakeRenderLoop();
+        }).share();
+
+        // Export mesh to a .ply file, concurrently with the upload and the bake
+        plyTask = std::async(std::launch::async, [&, meshTask]() {
+            meshTask.wait();
+            write_ply(vertices, normals, "output.ply");
+        }).share();
+
+        if (bake) {
+            bakeTask = std::async(std::launch::async, [&, meshTask]() {
+                meshTask.wait();
+                if (!vertices.empty())
+                    map = bake_normal_map(vertices, scalarFunction, isovalue, 2048);
+                wakeRenderLoop();
+            }).share();
+        }
+    }
+
     // Initialize GLFW
     if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
+        LOG_ERROR("Failed to initialize GLFW");
         return -1;
     }
 
     // Set GLFW window hints for OpenGL version and profile
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // The compute path needs OpenGL 4.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, useGpu ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Create a GLFW window
     GLFWwindow* window = glfwCreateWindow(800, 600, "CS3388 Camera Test", nullptr, nullptr);
     if (!window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
+        LOG_ERROR("Failed to create GLFW window");
         glfwTerminate();
         return -1;
     }
 
     glfwMakeContextCurrent(window);
+    wakeEnabled = true; // Tasks that finished before this point are picked up by the first frame
 
     // Initialize GLEW
     glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) {
-        std::cerr << "Failed to initialize GLEW" << std::endl;
+        LOG_ERROR("Failed to initialize GLEW");
+        wakeEnabled = false;
         return -1;
     }
 
-    // Load shaders
-    GLuint shaderProgram = loadShaders("vertex_shader.glsl", "fragment_shader.glsl");
+    // Start compiling both programs; with parallel compile they build on driver threads meanwhile
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    GLuint shaderProgram = startShaders("vertex_shader.glsl", "fragment_shader.glsl");
+    GLuint raymarchProgram = startShaders("raymarch_vertex.glsl", "raymarch_fragment.glsl", "field.glsl");
 
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
@@ -152,46 +418,170 @@ int main() {
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, cursor_position_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+
+
+    // GPU path: extract straight into a vertex buffer, no CPU mesh and no upload.
+    // field.glsl must match scalarFunction above.
+    GpuMarchingCubes* gpuMesh = nullptr;
+    GLsizei gpuVertices = 0; // Number of vertices drawn by gpuMesh, if known
+    if (useGpu) {
+        gpuMesh = new GpuMarchingCubes("field.glsl", 1 << 21);
+        gpuMesh->extract(isovalue, min, max, step);
+        if (gpuMesh->truncated())
+            LOG_WARN("Only part of the surface is drawn; use a larger --step");
+        if (exporter) // One read-back, so the triangle metrics cover the GPU mesh too
+            gpuVertices = static_cast<GLsizei>(gpuMesh->readTriangleCount() * 3);
+    }
 
-    // Define scalar function for marching cubes
-    auto scalarFunction = [](float x, float y, float z) {
-        return cos(x * 2) - sin(y * 2) - sin(z * 2);
-    };
-
-    float isovalue = -1.5f; // Isovalue for the scalar field
-    float min = -5.0f;      // Minimum bounds for the field
-    float max = 5.0f;       // Maximum bounds for the field
-    float step = 0.2f;      // Step size for sampling
-
-    // Generate mesh using marching cubes
-    auto vertices = marching_cubes(scalarFunction, isovalue, min, max, step);
-    auto normals = compute_normals(vertices);
-
-    // Export mesh to a .ply file
-    write_ply(vertices, normals, "output.ply");
+    // Meshes and the normal map are uploaded by a loader thread on a shared context, so a large
+    // transfer never stalls the frame loop; the render loop only points the VAOs at the result
+    GLLoader* loader = new GLLoader(window);
+    loader->setCompletionCallback(wakeRenderLoop);
 
-    // Upload mesh data to GPU
+    // Mesh buffers, filled when the extraction task finishes
     glGenVertexArrays(1, &VAO);
     glGenBuffers(2, VBO);
+    GLsizei meshCount = 0;  // Number of vertices uploaded so far
+    bool meshUploaded = false, bakeUploaded = false; // Sent to the loader
+    GLuint normalMapTexture = 0, uvVBO = 0;          // Created by the loader
+    bool normalMapReady = false;                     // The loader finished the normal map
+
+    // Progressive path: coarse preview of every region now, full resolution swapped in as regions finish
+    ProgressiveMesher* mesher = nullptr;
+    std::vector<RegionBuffers> regions;
+    std::vector<RegionMesh> fineRegions; // Kept for the .ply export once every region is refined
+    bool exported = false;
+    if (progressive) {
+        mesher = new ProgressiveMesher(scalarFunction, isovalue, min, max, step);
+        mesher->setCompletionCallback(wakeRenderLoop);
+        mesher->start(camera.getPosition());
+        regions.resize(mesher->regionCount());
+        for (auto& region : regions)
+            glGenVertexArrays(1, &region.vao);
+    }
 
-    glBindVertexArray(VAO);
-
-    // Vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // layout(location = 0)
-    glEnableVertexAttribArray(0);
-
-    // Normal buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // layout(location = 1)
-    glEnableVertexAttribArray(1);
+    // The raymarched view draws a full-screen triangle from gl_VertexID, but core profile needs a VAO bound
+    GLuint emptyVAO;
+    glGenVertexArrays(1, &emptyVAO);
 
-    glBindVertexArray(0); // Unbind VAO
+    // Both programs are needed from the first frame on
+    checkShaders(shaderProgram);
+    checkShaders(raymarchProgram);
 
     // Main rendering loop
+    // By default a frame is drawn only when the camera, the mesh or the window changed, and the loop
+    // sleeps in glfwWaitEvents in between; worker threads wake it when they finish a mesh.
+    long frames = 0;
+    double startTime = glfwGetTime();
+    std::clock_t startCpu = std::clock();
     while (!glfwWindowShouldClose(window)) {
+        // Hand the startup results that became ready since the last frame to the loader
+        if (!meshUploaded && isReady(meshTask)) {
+            meshUploaded = true;
+            loader->submit([&]() { fillMeshBuffers(VBO, vertices, normals); },
+                           [&]() {
+                               bindMeshBuffers(VAO, VBO);
+                               meshCount = static_cast<GLsizei>(vertices.size() / 3);
+                               redraw = true;
+                           });
+        }
+        if (meshUploaded && !bakeUploaded && isReady(bakeTask)) {
+            bakeUploaded = true;
+            if (!map.texels.empty()) {
+                loader->submit([&]() {
+                                   glGenBuffers(1, &uvVBO);
+                                   glBindBuffer(GL_ARRAY_BUFFER, uvVBO);
+                                   glBufferData(GL_ARRAY_BUFFER, map.uvs.size() * sizeof(float), map.uvs.data(), GL_STATIC_DRAW);
+                                   uploadBytes.add(map.uvs.size() * sizeof(float));
+                                   memory_track_gl(MEM_GPU_BUFFERS, uvVBO, map.uvs.size() * sizeof(float));
+                                   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+                                   // Charts are separated by gutters only at full resolution, so no mipmaps
+                                   glGenTextures(1, &normalMapTexture);
+                                   glBindTexture(GL_TEXTURE_2D, normalMapTexture);
+                                   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                                   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, map.width, map.height, 0, GL_RGB, GL_UNSIGNED_BYTE, map.texels.data());
+                                   memory_track_gl(MEM_GPU_TEXTURES, normalMapTexture, static_cast<size_t>(map.width) * map.height * 3);
+                                   uploadBytes.add(map.texels.size());
+                                   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                                   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                                   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                                   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                                   glBindTexture(GL_TEXTURE_2D, 0);
+                               },
+                               [&]() {
+                                   glBindVertexArray(VAO);
+                                   glBindBuffer(GL_ARRAY_BUFFER, uvVBO);
+                                   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0); // layout(location = 2)
+                                   glEnableVertexAttribArray(2);
+                                   glBindVertexArray(0);
+                                   normalMapReady = true;
+                                   LOG_INFO("Baked a {}x{} normal map for {} triangles", map.width, map.height, vertices.size() / 9);
+                                   map = NormalMap(); // Release the CPU copy
+                                   redraw = true;
+                               });
+            }
+        }
+
+        // Send the regions finished since the last frame to the loader; each one is swapped in when
+        // its buffers are complete, and the buffers it replaces are released then
+        if (mesher) {
+            std::vector<RegionMesh> ready;
+            mesher->poll(ready);
+            for (auto& mesh : ready) {
+                RegionBuffers& region = regions[mesh.region];
+                if (region.fine && !mesh.fine) continue; // Never replace a refined region by its preview
+                region.fine = mesh.fine;
+                auto upload = std::make_shared<RegionUpload>();
+                upload->mesh = std::move(mesh);
+                loader->submit([upload]() {
+                                   glGenBuffers(2, upload->vbo);
+                                   fillMeshBuffers(upload->vbo, upload->mesh.vertices, upload->mesh.normals);
+                               },
+                               [&, upload]() {
+                                   RegionBuffers& region = regions[upload->mesh.region];
+                                   bindMeshBuffers(region.vao, upload->vbo);
+                                   if (region.vbo[0]) {
+                                       memory_release_gl(MEM_GPU_BUFFERS, 2, region.vbo);
+                                       glDeleteBuffers(2, region.vbo);
+                                   }
+                                   region.vbo[0] = upload->vbo[0];
+                                   region.vbo[1] = upload->vbo[1];
+                                   region.count = static_cast<GLsizei>(upload->mesh.vertices.size() / 3);
+                                   LOG_DEBUG("Frame {}: uploaded {} region {} ({} triangles)", frames,
+                                             upload->mesh.fine ? "fine" : "coarse", upload->mesh.region,
+                                             upload->mesh.vertices.size() / 9);
+                                   if (upload->mesh.fine) fineRegions.push_back(std::move(upload->mesh));
+                                   redraw = true;
+                               });
+            }
+
+            // Export mesh to a .ply file once the whole domain is at full resolution
+            if (!exported && mesher->finished() && loader->pending() == 0) {
+                for (const auto& mesh : fineRegions) {
+                    vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+                    normals.insert(normals.end(), mesh.normals.begin(), mesh.normals.end());
+                }
+                write_ply(vertices, normals, "output.ply");
+                fineRegions.clear();
+                exported = true;
+            }
+        }
+
+        // Swap in the uploads the GPU has finished
+        loader->poll();
+
+        if (!continuous && !redraw) {
+            glfwWaitEvents(); // Sleep until input, a window event or a finished task
+            continue;
+        }
+        redraw = false;
+        ++frames;
+        auto frameStart = std::chrono::steady_clock::now();
+        GLsizei frameVertices = 0;
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Calculate transformation matrices
@@ -199,23 +589,103 @@ int main() {
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.f / 600.f, 0.1f, 100.f);
         glm::mat4 model = glm::mat4(1.0f);
 
-        // Use shader program and set uniforms
-        glUseProgram(shaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-        // Render the mesh
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 3);
-        glBindVertexArray(0);
+        if (raymarchView) {
+            // Trace field.glsl directly: no extraction and no upload when the isovalue changes
+            glm::mat4 viewProjection = projection * view;
+            glUseProgram(raymarchProgram);
+            glUniformMatrix4fv(glGetUniformLocation(raymarchProgram, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+            glUniformMatrix4fv(glGetUniformLocation(raymarchProgram, "invViewProjection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(viewProjection)));
+            glUniform3f(glGetUniformLocation(raymarchProgram, "boundsMin"), min, min, min);
+            glUniform3f(glGetUniformLocation(raymarchProgram, "boundsMax"), max, max, max);
+            glUniform1f(glGetUniformLocation(raymarchProgram, "isovalue"), traceIsovalue);
+            glUniform1f(glGetUniformLocation(raymarchProgram, "lipschitz"), 3.5f); // |grad| <= 2 * sqrt(3) for the default field
+            glUniform1f(glGetUniformLocation(raymarchProgram, "minStep"), step * 0.05f);
+            glUniform1i(glGetUniformLocation(raymarchProgram, "maxSteps"), 512);
+
+            glBindVertexArray(emptyVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+        } else {
+            // Use shader program and set uniforms
+            glUseProgram(shaderProgram);
+            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniform1i(glGetUniformLocation(shaderProgram, "useNormalMap"), normalMapReady);
+            if (normalMapReady) {
+                glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+                glUniformMatrix3fv(glGetUniformLocation(shaderProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, normalMapTexture);
+                glUniform1i(glGetUniformLocation(shaderProgram, "normalMap"), 0);
+            }
+
+            // Render the mesh
+            if (gpuMesh) {
+                gpuMesh->draw();
+                frameVertices = gpuVertices;
+            } else if (mesher) {
+                for (const auto& region : regions) {
+                    if (region.count == 0) continue;
+                    glBindVertexArray(region.vao);
+                    glDrawArrays(GL_TRIANGLES, 0, region.count);
+                    frameVertices += region.count;
+                }
+                glBindVertexArray(0);
+            } else {
+                glBindVertexArray(VAO);
+                glDrawArrays(GL_TRIANGLES, 0, meshCount); // Nothing until the extraction has finished
+                glBindVertexArray(0);
+                frameVertices = meshCount;
+            }
+        }
 
         // Swap buffers and poll events
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        frameSeconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count());
+        framesDrawn.add();
+        trianglesDrawn.set(frameVertices / 3);
+        trianglesDrawnTotal.add(frameVertices / 3);
+    }
+
+    // Idle cost of the session: frames drawn and process CPU time (all threads) over wall time
+    double seconds = glfwGetTime() - startTime;
+    double cpuSeconds = static_cast<double>(std::clock() - startCpu) / CLOCKS_PER_SEC;
+    LOG_INFO("Drew {} frames in {} s ({}), CPU time {} s ({}% of a core)", frames, seconds,
+             continuous ? "continuous" : "on demand", cpuSeconds, seconds > 0.0 ? 100.0 * cpuSeconds / seconds : 0.0);
+
+    if (memoryReport)
+        memory_report();
+
+    // Stop worker threads from posting events, and wait for the startup tasks that may still be
+    // running (a bake or the .ply export of a window closed early), before GLFW goes away
+    wakeEnabled = false;
+    for (auto* task : {&meshTask, &bakeTask, &plyTask}) {
+        if (task->valid())
+            task->wait();
     }
 
-    // Terminate GLFW
+    // Release GPU resources while the context is still alive, then terminate GLFW.
+    // The uploads in flight are finished and swapped in first, so every buffer they made is released.
+    while (loader->pending() > 0)
+        loader->poll();
+    delete loader;
+    delete gpuMesh;
+    delete mesher;
+    for (auto& region : regions) {
+        if (region.vbo[0]) {
+            memory_release_gl(MEM_GPU_BUFFERS, 2, region.vbo);
+            glDeleteBuffers(2, region.vbo);
+        }
+    }
+    if (normalMapTexture) {
+        memory_release_gl(MEM_GPU_TEXTURES, 1, &normalMapTexture);
+        memory_release_gl(MEM_GPU_BUFFERS, 1, &uvVBO);
+        glDeleteTextures(1, &normalMapTexture);
+        glDeleteBuffers(1, &uvVBO);
+    }
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
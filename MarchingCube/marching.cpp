@@ -3,13 +3,17 @@
 // It also includes functionality for computing normals and exporting the mesh to a PLY file.
 
 #include "marching.hpp"
-#include "TriTable.hpp" // Lookup table for Marching Cubes edge configurations
+#include "marching_kernel.hpp" // Row classification and active-cell triangulation
 #include <glm/glm.hpp>
-#include <array>
 #include <vector>
 #include <functional>
+#include <cmath>
+#include <algorithm>
 #include <fstream> // For PLY output
-#include <iostream> // For std::cout and std::cerr
+#include <chrono>
+#include "log.hpp"
+#include "memory.hpp"
+#include "metrics.hpp"
 
 // Interpolates a vertex position along an edge between two points based on the scalar values at those points.
 // Parameters:
@@ -22,6 +26,95 @@ glm::vec3 interpolateVertex(const glm::vec3& p1, const glm::vec3& p2, float valp
     return p1 + t * (p2 - p1); // Interpolated position
 }
 
+// Triangulates a single cube from its corner positions and scalar values.
+// Parameters:
+// - pos: Positions of the 8 cube corners.
+// - val: Scalar values at the 8 cube corners.
+// - isovalue: The isosurface value to extract.
+// - vertices: Output vector; the generated triangles are appended to it.
+// Returns: The number of triangles appended.
+int polygonise_cube(const glm::vec3 pos[8], const float val[8], float isovalue, std::vector<float>& vertices) {
+    // Determine cube index based on scalar values
+    int cubeIndex = 0;
+    for (int i = 0; i < 8; ++i)
+        if (val[i] < isovalue)
+            cubeIndex |= (1 << i);
+
+    return emit_cell_triangles(cubeIndex, pos, val, isovalue, vertices);
+}
+
+// Builds a lattice covering [min, max] with the given spacing per axis.
+Lattice make_lattice(const glm::vec3& min, const glm::vec3& max, const glm::vec3& stepsize) {
+    Lattice lattice;
+    lattice.min = min;
+    lattice.step = stepsize;
+    for (int axis = 0; axis < 3; ++axis) {
+        // Rounded up from the integer ratio (with a tolerance for float noise), never by accumulating steps
+        float ratio = (max[axis] - min[axis]) / stepsize[axis];
+        lattice.cells[axis] = std::max(1, static_cast<int>(std::ceil(ratio - 1e-4f)));
+    }
+    return lattice;
+}
+
+// Builds a lattice covering exactly [min, max] with the given number of cells per axis.
+Lattice make_lattice(const glm::vec3& min, const glm::vec3& max, const glm::ivec3& resolution) {
+    Lattice lattice;
+    lattice.min = min;
+    lattice.cells = glm::max(resolution, glm::ivec3(1));
+    lattice.step = (max - min) / glm::vec3(lattice.cells);
+    return lattice;
+}
+
+// Implements the Marching Cubes algorithm on a lattice.
+// Parameters:
+// - f: Scalar field function that takes (x, y, z) and returns a scalar value.
+// - isovalue: The isosurface value to extract.
+// - lattice: The sampling lattice.
+// Returns: A vector of vertices representing the generated mesh.
+std::vector<float> marching_cubes(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    const Lattice& lattice
+) {
+    static Counter& jobs = metrics_counter("marching_meshing_jobs_total", "Meshing jobs run", "engine=\"cpu\"");
+    static Histogram& seconds = metrics_histogram("marching_meshing_seconds", "Duration of meshing jobs",
+                                                  {0.001, 0.01, 0.1, 0.5, 1, 5, 30, 120}, "engine=\"cpu\"");
+    auto start = std::chrono::steady_clock::now();
+
+    MemoryScope scope(MEM_MESHING); // The returned vertices stay charged to meshing until freed
+    std::vector<float> vertices;
+    MarchingWorkspace workspace;
+
+    // Each lattice point is sampled once; only cells crossed by the surface are triangulated
+    march_triangles(lattice, f, isovalue, workspace, 0, lattice.cells.x, vertices);
+
+    jobs.add();
+    seconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return vertices;
+}
+
+// Implements the Marching Cubes algorithm over a box with a step size per axis.
+std::vector<float> marching_cubes(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    const glm::vec3& min,
+    const glm::vec3& max,
+    const glm::vec3& stepsize
+) {
+    return marching_cubes(f, isovalue, make_lattice(min, max, stepsize));
+}
+
+// Implements the Marching Cubes algorithm over a box with a number of cells per axis.
+std::vector<float> marching_cubes(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    const glm::vec3& min,
+    const glm::vec3& max,
+    const glm::ivec3& resolution
+) {
+    return marching_cubes(f, isovalue, make_lattice(min, max, resolution));
+}
+
 // Implements the Marching Cubes algorithm to generate a 3D mesh from a scalar field.
 // Parameters:
 // - f: Scalar field function that takes (x, y, z) and returns a scalar value.
@@ -36,67 +129,7 @@ std::vector<float> marching_cubes(
     float max,
     float stepsize
 ) {
-    std::vector<float> vertices;
-
-    // Cube corner offsets
-    glm::vec3 cubeVerts[8] = {
-        {0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1},
-        {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1}
-    };
-
-    // Edge vertex pairs
-    const int edgeConnections[12][2] = {
-        {0, 1}, {1, 2}, {2, 3}, {3, 0},
-        {4, 5}, {5, 6}, {6, 7}, {7, 4},
-        {0, 4}, {1, 5}, {2, 6}, {3, 7}
-    };
-
-    // Iterate through the scalar field
-    for (float x = min; x < max; x += stepsize) {
-        for (float y = min; y < max; y += stepsize) {
-            for (float z = min; z < max; z += stepsize) {
-                glm::vec3 cubePos = glm::vec3(x, y, z); // Current cube position
-                glm::vec3 pos[8]; // Positions of cube corners
-                float val[8];     // Scalar values at cube corners
-
-                // Evaluate scalar field at cube corners
-                for (int i = 0; i < 8; ++i) {
-                    pos[i] = cubePos + cubeVerts[i] * stepsize;
-                    val[i] = f(pos[i].x, pos[i].y, pos[i].z);
-                }
-
-                // Determine cube index based on scalar values
-                int cubeIndex = 0;
-                for (int i = 0; i < 8; ++i)
-                    if (val[i] < isovalue)
-                        cubeIndex |= (1 << i);
-
-                // Get edge configuration from lookup table
-                const int* triEdges = marching_cubes_lut[cubeIndex];
-                if (triEdges[0] == -1) continue; // Skip if no triangles
-
-                // Compute edge vertices
-                glm::vec3 edgeVertex[12];
-                for (int i = 0; i < 12; ++i) {
-                    int v0 = edgeConnections[i][0];
-                    int v1 = edgeConnections[i][1];
-                    edgeVertex[i] = interpolateVertex(pos[v0], pos[v1], val[v0], val[v1], isovalue);
-                }
-
-                // Build triangles
-                for (int i = 0; triEdges[i] != -1; i += 3) {
-                    for (int j = 0; j < 3; ++j) {
-                        glm::vec3 v = edgeVertex[triEdges[i + j]];
-                        vertices.push_back(v.x);
-                        vertices.push_back(v.y);
-                        vertices.push_back(v.z);
-                    }
-                }
-            }
-        }
-    }
-
-    return vertices;
+    return marching_cubes(f, isovalue, make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(stepsize)));
 }
 
 // Computes flat normals for each triangle in the mesh.
@@ -105,7 +138,18 @@ std::vector<float> marching_cubes(
 // Returns: A vector of normals corresponding to the vertices.
 std::vector<float> compute_normals(const std::vector<float>& vertices) {
     std::vector<float> normals;
-    for (size_t i = 0; i < vertices.size(); i += 9) {
+    compute_normals(vertices, normals);
+    return normals;
+}
+
+// Computes flat normals into an existing vector, reusing its storage.
+// Parameters:
+// - vertices: A vector of vertices representing the mesh.
+// - normals: Output vector; resized to the size of vertices.
+void compute_normals(const std::vector<float>& vertices, std::vector<float>& normals) {
+    MemoryScope scope(MEM_NORMALS);
+    normals.resize(vertices.size());
+    for (size_t i = 0; i + 9 <= vertices.size(); i += 9) {
         glm::vec3 v0(vertices[i],     vertices[i+1], vertices[i+2]);
         glm::vec3 v1(vertices[i+3],   vertices[i+4], vertices[i+5]);
         glm::vec3 v2(vertices[i+6],   vertices[i+7], vertices[i+8]);
@@ -113,14 +157,13 @@ std::vector<float> compute_normals(const std::vector<float>& vertices) {
         // Compute the normal using the cross product
         glm::vec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
 
-        // Add the same normal for all three vertices of the triangle
+        // Same normal for all three vertices of the triangle
         for (int j = 0; j < 3; ++j) {
-            normals.push_back(normal.x);
-            normals.push_back(normal.y);
-            normals.push_back(normal.z);
+            normals[i + 3 * j]     = normal.x;
+            normals[i + 3 * j + 1] = normal.y;
+            normals[i + 3 * j + 2] = normal.z;
         }
     }
-    return normals;
 }
 
 // Writes the vertices and normals to an ASCII PLY file.
@@ -129,9 +172,10 @@ std::vector<float> compute_normals(const std::vector<float>& vertices) {
 // - normals: A vector of normals corresponding to the vertices.
 // - filename: The name of the output PLY file.
 void write_ply(const std::vector<float>& vertices, const std::vector<float>& normals, const std::string& filename) {
+    MemoryScope scope(MEM_EXPORT);
     std::ofstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filename << std::endl;
+        LOG_ERROR("Failed to open file: {}", filename);
         return;
     }
 
@@ -155,5 +199,5 @@ void write_ply(const std::vector<float>& vertices, const std::vector<float>& nor
     }
 
     file.close();
-    std::cout << "Wrote " << filename << " with " << numVertices << " vertices.\n";
+    LOG_INFO("Wrote {} with {} vertices.", filename, numVertices);
 }
\ No newline at end of file
@@ -26,6 +26,81 @@ std::vector<float> marching_cubes(
     float stepsize
 );
 
+// A regular sampling lattice with independent bounds and spacing per axis.
+// Lattice point (x, y, z) is at min + (x, y, z) * step; there are cells + 1 points along each axis.
+struct Lattice {
+    glm::vec3 min;   // Position of lattice point (0, 0, 0)
+    glm::vec3 step;  // Spacing of the lattice points along each axis
+    glm::ivec3 cells; // Number of cells along each axis
+
+    // Returns the position of a lattice point
+    glm::vec3 point(int x, int y, int z) const {
+        return min + glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) * step;
+    }
+
+    // Returns the total number of cells
+    size_t cellCount() const {
+        return static_cast<size_t>(cells.x) * cells.y * cells.z;
+    }
+};
+
+// Builds a lattice covering [min, max] with the given spacing per axis.
+// Cell counts are rounded up, so the last cell may end slightly past max (as in marching_cubes()).
+// Parameters:
+// - min, max: The bounds of the scalar field.
+// - stepsize: The spacing along each axis.
+// Returns: The lattice.
+Lattice make_lattice(const glm::vec3& min, const glm::vec3& max, const glm::vec3& stepsize);
+
+// Builds a lattice covering exactly [min, max] with the given number of cells per axis.
+// Parameters:
+// - min, max: The bounds of the scalar field.
+// - resolution: The number of cells along each axis.
+// Returns: The lattice.
+Lattice make_lattice(const glm::vec3& min, const glm::vec3& max, const glm::ivec3& resolution);
+
+// Generates a 3D mesh using the Marching Cubes algorithm on an arbitrary lattice.
+// Parameters:
+// - f: A scalar field function that takes (x, y, z) as input and returns a scalar value.
+// - isovalue: The isosurface value to extract from the scalar field.
+// - lattice: The sampling lattice (see make_lattice()).
+// Returns: A vector of vertices representing the generated mesh.
+std::vector<float> marching_cubes(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    const Lattice& lattice
+);
+
+// Generates a 3D mesh over a box with a separate step size per axis (e.g. anisotropic CT spacing).
+// Parameters:
+// - f: A scalar field function that takes (x, y, z) as input and returns a scalar value.
+// - isovalue: The isosurface value to extract from the scalar field.
+// - min, max: The bounds of the box.
+// - stepsize: The step size along each axis.
+// Returns: A vector of vertices representing the generated mesh.
+std::vector<float> marching_cubes(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    const glm::vec3& min,
+    const glm::vec3& max,
+    const glm::vec3& stepsize
+);
+
+// Generates a 3D mesh over a box with a given number of cells per axis.
+// Parameters:
+// - f: A scalar field function that takes (x, y, z) as input and returns a scalar value.
+// - isovalue: The isosurface value to extract from the scalar field.
+// - min, max: The bounds of the box.
+// - resolution: The number of cells along each axis.
+// Returns: A vector of vertices representing the generated mesh.
+std::vector<float> marching_cubes(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    const glm::vec3& min,
+    const glm::vec3& max,
+    const glm::ivec3& resolution
+);
+
 // Interpolates a vertex position along an edge between two points based on scalar values.
 // Parameters:
 // - p1, p2: The two points defining the edge.
@@ -38,12 +113,28 @@ glm::vec3 interpolateVertex(
     float isovalue
 );
 
+// Triangulates a single cube from its corner positions and scalar values.
+// Corners follow the standard Marching Cubes ordering used by TriTable.hpp.
+// Parameters:
+// - pos: Positions of the 8 cube corners.
+// - val: Scalar values at the 8 cube corners.
+// - isovalue: The isosurface value to extract.
+// - vertices: Output vector; the generated triangles are appended to it.
+// Returns: The number of triangles appended.
+int polygonise_cube(const glm::vec3 pos[8], const float val[8], float isovalue, std::vector<float>& vertices);
+
 // Computes flat normals for each triangle in the mesh.
 // Parameters:
 // - vertices: A vector of vertices representing the mesh.
 // Returns: A vector of normals corresponding to the vertices.
 std::vector<float> compute_normals(const std::vector<float>& vertices);
 
+// Computes flat normals into an existing vector, reusing its storage (no allocation once it is large enough).
+// Parameters:
+// - vertices: A vector of vertices representing the mesh.
+// - normals: Output vector; resized to the size of vertices.
+void compute_normals(const std::vector<float>& vertices, std::vector<float>& normals);
+
 // Writes the vertices and normals to an ASCII PLY file.
 // Parameters:
 // - vertices: A vector of vertices representing the mesh.
@@ -0,0 +1,339 @@
+// marching_kernel.hpp
+// This header holds the inner loops of the CPU Marching Cubes engine. It is internal to the
+// engine (marching.cpp and friends) and not part of the public interface in marching.hpp.
+//
+// The lattice is swept one x-slice at a time, so every lattice point is sampled exactly once.
+// Cells are classified a whole z-row at a time from the cached samples (four cells per SSE2
+// compare and movemask), and only cells whose case produces triangles reach interpolation.
+// All scratch memory lives in a MarchingWorkspace that callers can keep between extractions.
+
+#ifndef MARCHING_KERNEL_HPP
+#define MARCHING_KERNEL_HPP
+
+#include "marching.hpp"
+#include "TriTable.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Classifies count consecutive cells along z.
+// Parameters:
+// - a0, a1: Samples of row y in slices x and x + 1 (count + 1 values each).
+// - b0, b1: Samples of row y + 1 in slices x and x + 1.
+// - isovalue: The isosurface value.
+// - cases: Output; the cube index of every cell.
+inline void classify_row(const float* a0, const float* a1, const float* b0, const float* b1,
+                         int count, float isovalue, uint8_t* cases) {
+    int z = 0;
+#if defined(__SSE2__)
+    // spread[m] has byte j set to bit j of m, which turns one 4-bit corner mask per corner
+    // into four cube indices at once.
+    static const uint32_t spread[16] = {
+        0x00000000, 0x00000001, 0x00000100, 0x00000101,
+        0x00010000, 0x00010001, 0x00010100, 0x00010101,
+        0x01000000, 0x01000001, 0x01000100, 0x01000101,
+        0x01010000, 0x01010001, 0x01010100, 0x01010101
+    };
+    const __m128 iso = _mm_set1_ps(isovalue);
+    auto below = [&](const float* p) { return spread[_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(p), iso))]; };
+
+    for (; z + 4 <= count; z += 4) {
+        // Corner order as in marching_cubes_corners
+        uint32_t quad = below(a0 + z)
+                      | below(a1 + z) << 1
+                      | below(a1 + z + 1) << 2
+                      | below(a0 + z + 1) << 3
+                      | below(b0 + z) << 4
+                      | below(b1 + z) << 5
+                      | below(b1 + z + 1) << 6
+                      | below(b0 + z + 1) << 7;
+        std::memcpy(cases + z, &quad, 4); // Byte j is cell z + j on a little-endian host
+    }
+#endif
+    for (; z < count; ++z) {
+        cases[z] = static_cast<uint8_t>((a0[z] < isovalue)
+                                      | (a1[z] < isovalue) << 1
+                                      | (a1[z + 1] < isovalue) << 2
+                                      | (a0[z + 1] < isovalue) << 3
+                                      | (b0[z] < isovalue) << 4
+                                      | (b1[z] < isovalue) << 5
+                                      | (b1[z + 1] < isovalue) << 6
+                                      | (b0[z + 1] < isovalue) << 7);
+    }
+}
+
+// Where each cube edge is cached: its axis (0 = x, 1 = y, 2 = z), the offset of its lower lattice point
+// from corner 0, and its corners ordered from the lower to the upper lattice point.
+constexpr int8_t marching_cubes_edge_slots[12][6] = {
+    {0, 0, 0, 0, 0, 1}, {2, 1, 0, 0, 1, 2}, {0, 0, 0, 1, 3, 2}, {2, 0, 0, 0, 0, 3},
+    {0, 0, 1, 0, 4, 5}, {2, 1, 1, 0, 5, 6}, {0, 0, 1, 1, 7, 6}, {2, 0, 1, 0, 4, 7},
+    {1, 0, 0, 0, 0, 4}, {1, 1, 0, 0, 1, 5}, {1, 1, 0, 1, 2, 6}, {1, 0, 0, 1, 3, 7}
+};
+
+// Appends the triangles of one classified cube, interpolating only the edges its case uses.
+// Edges go from their lower to their upper lattice point, as in for_each_cached_triangle().
+// Parameters:
+// - cubeIndex: The cube configuration.
+// - pos, val: Positions and scalar values of the 8 corners.
+// - isovalue: The isosurface value.
+// - vertices: Output vector; the triangles are appended to it.
+// Returns: The number of triangles appended.
+inline int emit_cell_triangles(int cubeIndex, const glm::vec3 pos[8], const float val[8], float isovalue,
+                               std::vector<float>& vertices) {
+    int numTriangles = marching_cubes_cases.triCount[cubeIndex];
+    if (numTriangles == 0) return 0;
+
+    glm::vec3 edgeVertex[12];
+    uint16_t flags = marching_cubes_cases.edgeFlags[cubeIndex];
+    for (int e = 0; e < 12; ++e) {
+        if (!(flags & (1u << e))) continue;
+        int lo = marching_cubes_edge_slots[e][4];
+        int hi = marching_cubes_edge_slots[e][5];
+        edgeVertex[e] = interpolateVertex(pos[lo], pos[hi], val[lo], val[hi], isovalue);
+    }
+
+    const int8_t* triEdges = marching_cubes_lut[cubeIndex];
+    for (int i = 0; i < numTriangles * 3; ++i) {
+        const glm::vec3& v = edgeVertex[triEdges[i]];
+        vertices.push_back(v.x);
+        vertices.push_back(v.y);
+        vertices.push_back(v.z);
+    }
+    return numTriangles;
+}
+
+// A cached edge crossing; valid while stamp matches the stamp of the slice or slab that owns it.
+struct EdgeSlot {
+    uint32_t stamp;
+    glm::vec3 point;
+};
+
+// Scratch memory of one sweep. Buffers only ever grow, so a workspace that is reused for lattices of
+// the same size performs no allocations; cached edges are invalidated by stamps instead of clearing.
+struct MarchingWorkspace {
+    std::vector<float> front, back;              // Samples of slices x and x + 1
+    std::vector<uint8_t> cases;                  // Cube indices of one z-row
+    std::vector<EdgeSlot> frontEdges, backEdges; // y- and z-edges of slices x and x + 1 (2 per point)
+    std::vector<EdgeSlot> xEdges;                // x-edges between slices x and x + 1
+    uint32_t frontStamp = 0, backStamp = 0, xStamp = 0;
+    uint32_t lastStamp = 0;
+
+    // Sizes the buffers for a lattice
+    void prepare(const Lattice& lattice) {
+        size_t points = static_cast<size_t>(lattice.cells.y + 1) * (lattice.cells.z + 1);
+        if (front.size() < points) {
+            front.resize(points);
+            back.resize(points);
+            frontEdges.resize(2 * points, EdgeSlot{0, glm::vec3(0.0f)});
+            backEdges.resize(2 * points, EdgeSlot{0, glm::vec3(0.0f)});
+            xEdges.resize(points, EdgeSlot{0, glm::vec3(0.0f)});
+        }
+        if (cases.size() < static_cast<size_t>(lattice.cells.z))
+            cases.resize(lattice.cells.z);
+    }
+
+    // Returns a stamp no cached edge carries yet
+    uint32_t newStamp() {
+        if (lastStamp == UINT32_MAX) { // About to wrap: forget every cached edge
+            for (auto* edges : {&frontEdges, &backEdges, &xEdges})
+                for (EdgeSlot& slot : *edges) slot.stamp = 0;
+            frontStamp = backStamp = xStamp = lastStamp = 1;
+        }
+        return ++lastStamp;
+    }
+};
+
+// Samples lattice slice x into a buffer of (cells.y + 1) * (cells.z + 1) values.
+template <typename Field>
+void sample_slice(const Lattice& lattice, Field&& f, int x, std::vector<float>& slice) {
+    const int ny = lattice.cells.y + 1;
+    const int nz = lattice.cells.z + 1;
+    for (int y = 0; y < ny; ++y)
+        for (int z = 0; z < nz; ++z) {
+            glm::vec3 p = lattice.point(x, y, z);
+            slice[y * nz + z] = f(p.x, p.y, p.z);
+        }
+}
+
+// The steps of a sweep, for callers that need to pause between rows (see marching_stream.hpp).
+// A sweep is begin_sweep(), then for every slab x: begin_slab(), march_row() for every y, end_slab().
+
+// Prepares the workspace and samples the first slice of a sweep starting at slab xBegin.
+template <typename Field>
+void begin_sweep(const Lattice& lattice, Field&& f, MarchingWorkspace& ws, int xBegin) {
+    ws.prepare(lattice);
+    sample_slice(lattice, f, xBegin, ws.front);
+    ws.frontStamp = ws.newStamp();
+}
+
+// Samples the far slice of slab x.
+template <typename Field>
+void begin_slab(const Lattice& lattice, Field&& f, MarchingWorkspace& ws, int x) {
+    sample_slice(lattice, f, x + 1, ws.back);
+    ws.backStamp = ws.newStamp();
+    ws.xStamp = ws.newStamp();
+}
+
+// Classifies the z-row (x, y) and calls visit(x, y, z, cubeIndex, pos, val) for its active cells.
+template <typename Visitor>
+void march_row(const Lattice& lattice, float isovalue, MarchingWorkspace& ws, int x, int y, Visitor&& visit) {
+    const int nz = lattice.cells.z + 1;
+    const float* a0 = &ws.front[y * nz];
+    const float* a1 = &ws.back[y * nz];
+    const float* b0 = a0 + nz;
+    const float* b1 = a1 + nz;
+    classify_row(a0, a1, b0, b1, lattice.cells.z, isovalue, ws.cases.data());
+
+    for (int z = 0; z < lattice.cells.z; ++z) {
+        int cubeIndex = ws.cases[z];
+        if (marching_cubes_cases.triCount[cubeIndex] == 0) continue;
+
+        glm::vec3 pos[8];
+        float val[8] = {a0[z], a1[z], a1[z + 1], a0[z + 1], b0[z], b1[z], b1[z + 1], b0[z + 1]};
+        for (int i = 0; i < 8; ++i)
+            pos[i] = lattice.point(x + marching_cubes_corners[i][0],
+                                   y + marching_cubes_corners[i][1],
+                                   z + marching_cubes_corners[i][2]);
+        visit(x, y, z, cubeIndex, pos, val);
+    }
+}
+
+// Makes the far slice of the finished slab the near slice of the next one.
+inline void end_slab(MarchingWorkspace& ws) {
+    ws.front.swap(ws.back);
+    ws.frontEdges.swap(ws.backEdges);
+    ws.frontStamp = ws.backStamp;
+}
+
+// Sweeps the slabs [xBegin, xEnd) of a lattice and calls visit(x, y, z, cubeIndex, pos, val) for every
+// cell that produces triangles, in x, y, z order.
+// Parameters:
+// - lattice: The sampling lattice.
+// - f: Scalar field, called once per lattice point of the swept slabs.
+// - isovalue: The isosurface value.
+// - ws: Scratch memory (see MarchingWorkspace).
+// - xBegin, xEnd: Range of cells along x.
+// - visit: Callback for the active cells.
+template <typename Field, typename Visitor>
+void march_lattice(const Lattice& lattice, Field&& f, float isovalue, MarchingWorkspace& ws,
+                   int xBegin, int xEnd, Visitor&& visit) {
+    begin_sweep(lattice, f, ws, xBegin);
+    for (int x = xBegin; x < xEnd; ++x) {
+        begin_slab(lattice, f, ws, x);
+        for (int y = 0; y < lattice.cells.y; ++y)
+            march_row(lattice, isovalue, ws, x, y, visit);
+        end_slab(ws);
+    }
+}
+
+// Calls emit(a, b, c) for every triangle of one cell visited by march_lattice(), looking each
+// crossing up in the workspace edge caches so that an edge shared by up to four cells is
+// interpolated only once. Every edge is interpolated from its lower to its upper lattice point,
+// so neighbouring cells produce bit-identical shared vertices.
+// Parameters:
+// - ws: The workspace passed to march_lattice().
+// - y, z, cubeIndex, pos, val: As passed to the visitor.
+// - isovalue: The isosurface value.
+// - nz: Number of lattice points along z (cells.z + 1).
+// - emit: Callback taking the three vertices of a triangle.
+template <typename Emit>
+void for_each_cached_triangle(MarchingWorkspace& ws, int y, int z, int cubeIndex,
+                              const glm::vec3 pos[8], const float val[8], float isovalue, int nz,
+                              Emit&& emit) {
+    const glm::vec3* edgeVertex[12];
+    uint16_t flags = marching_cubes_cases.edgeFlags[cubeIndex];
+    for (int e = 0; e < 12; ++e) {
+        if (!(flags & (1u << e))) continue;
+        const int8_t* slot = marching_cubes_edge_slots[e];
+        int point = (y + slot[2]) * nz + z + slot[3];
+        EdgeSlot* cached;
+        uint32_t stamp;
+        if (slot[0] == 0) {
+            cached = &ws.xEdges[point];
+            stamp = ws.xStamp;
+        } else {
+            cached = slot[1] ? &ws.backEdges[2 * point + slot[0] - 1] : &ws.frontEdges[2 * point + slot[0] - 1];
+            stamp = slot[1] ? ws.backStamp : ws.frontStamp;
+        }
+        if (cached->stamp != stamp) {
+            int lo = slot[4], hi = slot[5];
+            cached->point = interpolateVertex(pos[lo], pos[hi], val[lo], val[hi], isovalue);
+            cached->stamp = stamp;
+        }
+        edgeVertex[e] = &cached->point;
+    }
+
+    const int8_t* triEdges = marching_cubes_lut[cubeIndex];
+    for (int i = 0; i < marching_cubes_cases.triCount[cubeIndex] * 3; i += 3)
+        emit(*edgeVertex[triEdges[i]], *edgeVertex[triEdges[i + 1]], *edgeVertex[triEdges[i + 2]]);
+}
+
+// Appends the triangles of one cell visited by march_lattice() (see for_each_cached_triangle()).
+inline void emit_cached_triangles(MarchingWorkspace& ws, int y, int z, int cubeIndex,
+                                  const glm::vec3 pos[8], const float val[8], float isovalue, int nz,
+                                  std::vector<float>& vertices) {
+    for_each_cached_triangle(ws, y, z, cubeIndex, pos, val, isovalue, nz,
+                             [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+                                 for (const glm::vec3* v : {&a, &b, &c}) {
+                                     vertices.push_back(v->x);
+                                     vertices.push_back(v->y);
+                                     vertices.push_back(v->z);
+                                 }
+                             });
+}
+
+// Extracts the triangles of the slabs [xBegin, xEnd) of a lattice.
+// Parameters:
+// - lattice, f, isovalue, ws, xBegin, xEnd: As for march_lattice().
+// - vertices: Output vector; the triangles are appended to it (layout of marching_cubes()).
+template <typename Field>
+void march_triangles(const Lattice& lattice, Field&& f, float isovalue, MarchingWorkspace& ws,
+                     int xBegin, int xEnd, std::vector<float>& vertices) {
+    const int nz = lattice.cells.z + 1;
+    march_lattice(lattice, f, isovalue, ws, xBegin, xEnd,
+                  [&](int, int y, int z, int cubeIndex, const glm::vec3* pos, const float* val) {
+                      emit_cached_triangles(ws, y, z, cubeIndex, pos, val, isovalue, nz, vertices);
+                  });
+}
+
+// Extracts the triangles of a block of cells of a lattice, sampling every factor-th lattice point.
+// Samples and corner positions come from the lattice points themselves (not from a sub-lattice with
+// its own origin), so blocks sharing a face produce bit-identical vertices on it, and a block with
+// factor 1 matches marching_cubes() on the whole lattice.
+// Parameters:
+// - lattice: The full lattice.
+// - f, isovalue, ws: As for march_lattice().
+// - begin: First lattice cell of the block.
+// - cells: Number of block cells along each axis; a block cell spans factor lattice cells.
+// - factor: Lattice cells per block cell along each axis.
+// - vertices: Output vector; the triangles are appended to it (layout of marching_cubes()).
+template <typename Field>
+void march_block(const Lattice& lattice, Field&& f, float isovalue, MarchingWorkspace& ws,
+                 const glm::ivec3& begin, const glm::ivec3& cells, int factor, std::vector<float>& vertices) {
+    // The sweep runs on the block's own lattice in index space: point (x, y, z) is at (x, y, z)
+    Lattice block{glm::vec3(0.0f), glm::vec3(1.0f), cells};
+    auto point = [&](int x, int y, int z) {
+        return lattice.point(begin.x + x * factor, begin.y + y * factor, begin.z + z * factor);
+    };
+    auto sample = [&](float x, float y, float z) {
+        glm::vec3 p = point(static_cast<int>(x), static_cast<int>(y), static_cast<int>(z));
+        return f(p.x, p.y, p.z);
+    };
+    const int nz = cells.z + 1;
+    march_lattice(block, sample, isovalue, ws, 0, cells.x,
+                  [&](int x, int y, int z, int cubeIndex, const glm::vec3*, const float* val) {
+                      glm::vec3 pos[8];
+                      for (int i = 0; i < 8; ++i)
+                          pos[i] = point(x + marching_cubes_corners[i][0],
+                                         y + marching_cubes_corners[i][1],
+                                         z + marching_cubes_corners[i][2]);
+                      emit_cached_triangles(ws, y, z, cubeIndex, pos, val, isovalue, nz, vertices);
+                  });
+}
+
+#endif // MARCHING_KERNEL_HPP
@@ -0,0 +1,215 @@
+// marching_squares.cpp
+// This file implements the Marching Squares contouring engine declared in marching_squares.hpp.
+
+#include "marching_squares.hpp"
+#include "memory.hpp"
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Segments for each square configuration, as pairs of cell edges (-1 terminates).
+// Corner bits: 1 = (0,0), 2 = (1,0), 4 = (1,1), 8 = (0,1); a bit is set when the corner is below the isovalue.
+// Edges: 0 = bottom, 1 = right, 2 = top, 3 = left.
+// The saddle cases 5 and 10 are listed for a centre value above the isovalue; see below.
+static const int segmentTable[16][5] = {
+    {-1, -1, -1, -1, -1}, {3, 0, -1, -1, -1}, {0, 1, -1, -1, -1}, {3, 1, -1, -1, -1},
+    {1, 2, -1, -1, -1},   {3, 0, 1, 2, -1},   {0, 2, -1, -1, -1}, {3, 2, -1, -1, -1},
+    {2, 3, -1, -1, -1},   {0, 2, -1, -1, -1}, {0, 1, 2, 3, -1},   {1, 2, -1, -1, -1},
+    {3, 1, -1, -1, -1},   {0, 1, -1, -1, -1}, {3, 0, -1, -1, -1}, {-1, -1, -1, -1, -1}
+};
+
+// Builds an axis-aligned slice covering [min, max] in the two other axes.
+SlicePlane axis_aligned_plane(int axis, float offset, float min, float max) {
+    SlicePlane plane;
+    plane.origin = glm::vec3(min);
+    plane.origin[axis] = offset;
+    plane.u = glm::vec3(0.0f);
+    plane.v = glm::vec3(0.0f);
+    plane.u[(axis + 1) % 3] = 1.0f;
+    plane.v[(axis + 2) % 3] = 1.0f;
+    plane.width = max - min;
+    plane.height = max - min;
+    return plane;
+}
+
+// Extracts the iso-contours of a scalar field on a single plane.
+std::vector<Polyline> marching_squares(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    const SlicePlane& plane,
+    float stepsize
+) {
+    MemoryScope scope(MEM_MESHING);
+    int nu = std::max(1, static_cast<int>(std::ceil(plane.width / stepsize - 1e-4f)));
+    int nv = std::max(1, static_cast<int>(std::ceil(plane.height / stepsize - 1e-4f)));
+    int rowSize = nu + 1;
+
+    auto pointAt = [&](float s, float t) {
+        return plane.origin + plane.u * (s * stepsize) + plane.v * (t * stepsize);
+    };
+
+    // Sample every grid point once
+    std::vector<float> values(static_cast<size_t>(rowSize) * (nv + 1));
+    for (int j = 0; j <= nv; ++j) {
+        for (int i = 0; i <= nu; ++i) {
+            glm::vec3 p = pointAt(static_cast<float>(i), static_cast<float>(j));
+            values[j * rowSize + i] = f(p.x, p.y, p.z);
+        }
+    }
+
+    // Grid edges are identified globally so that neighbouring cells share their crossing points:
+    // 2 * point is the edge from that point along u, 2 * point + 1 the edge along v.
+    std::vector<glm::vec3> edgePoint(values.size() * 2);
+    std::vector<int> edgeSegments(values.size() * 4, -1); // Up to two segments per edge
+    std::vector<int> segments;                             // Pairs of edge ids
+
+    auto crossing = [&](int i0, int j0, int i1, int j1) {
+        float a = values[j0 * rowSize + i0];
+        float b = values[j1 * rowSize + i1];
+        float t = (isovalue - a) / (b - a);
+        return pointAt(i0 + t * (i1 - i0), j0 + t * (j1 - j0));
+    };
+
+    for (int j = 0; j < nv; ++j) {
+        for (int i = 0; i < nu; ++i) {
+            float v0 = values[j * rowSize + i];
+            float v1 = values[j * rowSize + i + 1];
+            float v2 = values[(j + 1) * rowSize + i + 1];
+            float v3 = values[(j + 1) * rowSize + i];
+
+            int squareIndex = 0;
+            if (v0 < isovalue) squareIndex |= 1;
+            if (v1 < isovalue) squareIndex |= 2;
+            if (v2 < isovalue) squareIndex |= 4;
+            if (v3 < isovalue) squareIndex |= 8;
+            if (squareIndex == 0 || squareIndex == 15) continue;
+
+            int edgeIds[4] = {
+                2 * (j * rowSize + i),           // bottom
+                2 * (j * rowSize + i + 1) + 1,   // right
+                2 * ((j + 1) * rowSize + i),     // top
+                2 * (j * rowSize + i) + 1        // left
+            };
+
+            // Resolve saddles with the centre value: when the centre is below the isovalue the
+            // two inside corners are connected and the contour separates the outside corners.
+            int cellSegments[4];
+            int numEdges = 0;
+            const int* table = segmentTable[squareIndex];
+            bool centreInside = (v0 + v1 + v2 + v3) * 0.25f < isovalue;
+            if (squareIndex == 5 && centreInside) {
+                const int alt[4] = {0, 1, 2, 3};
+                std::copy(alt, alt + 4, cellSegments);
+                numEdges = 4;
+            } else if (squareIndex == 10 && centreInside) {
+                const int alt[4] = {3, 0, 1, 2};
+                std::copy(alt, alt + 4, cellSegments);
+                numEdges = 4;
+            } else {
+                for (; table[numEdges] != -1; ++numEdges)
+                    cellSegments[numEdges] = table[numEdges];
+            }
+
+            for (int k = 0; k < numEdges; ++k) {
+                int e = cellSegments[k];
+                int id = edgeIds[e];
+                if (edgeSegments[2 * id] == -1 && edgeSegments[2 * id + 1] == -1) {
+                    switch (e) {
+                    case 0: edgePoint[id] = crossing(i, j, i + 1, j); break;
+                    case 1: edgePoint[id] = crossing(i + 1, j, i + 1, j + 1); break;
+                    case 2: edgePoint[id] = crossing(i, j + 1, i + 1, j + 1); break;
+                    case 3: edgePoint[id] = crossing(i, j, i, j + 1); break;
+                    }
+                }
+                int segment = static_cast<int>(segments.size()) / 2;
+                edgeSegments[2 * id + (edgeSegments[2 * id] == -1 ? 0 : 1)] = segment;
+                segments.push_back(id);
+            }
+        }
+    }
+
+    // Chain segments into polylines by walking through shared edges
+    int numSegments = static_cast<int>(segments.size()) / 2;
+    std::vector<bool> used(numSegments, false);
+    std::vector<Polyline> polylines;
+
+    // Returns the unused segment attached to an edge, or -1
+    auto nextSegment = [&](int edge) {
+        for (int k = 0; k < 2; ++k) {
+            int s = edgeSegments[2 * edge + k];
+            if (s != -1 && !used[s]) return s;
+        }
+        return -1;
+    };
+
+    // Follows the chain from an edge, appending the edges it passes through
+    auto walk = [&](int edge, std::vector<int>& chain) {
+        for (int s = nextSegment(edge); s != -1; s = nextSegment(edge)) {
+            used[s] = true;
+            edge = (segments[2 * s] == edge) ? segments[2 * s + 1] : segments[2 * s];
+            chain.push_back(edge);
+        }
+    };
+
+    for (int s = 0; s < numSegments; ++s) {
+        if (used[s]) continue;
+        used[s] = true;
+
+        std::vector<int> forward = {segments[2 * s], segments[2 * s + 1]};
+        walk(forward.back(), forward);
+
+        // Open contours may also extend from the start of the first segment
+        if (forward.back() != forward.front()) {
+            std::vector<int> backward;
+            walk(forward.front(), backward);
+            forward.insert(forward.begin(), backward.rbegin(), backward.rend());
+        }
+
+        Polyline line;
+        line.reserve(forward.size());
+        for (int edge : forward)
+            line.push_back(edgePoint[edge]);
+        polylines.push_back(std::move(line));
+    }
+
+    return polylines;
+}
+
+// Extracts the iso-contours on a stack of parallel slices, distributing slices over threads.
+std::vector<std::vector<Polyline>> marching_squares_slices(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    const SlicePlane& plane,
+    float spacing,
+    int count,
+    float stepsize,
+    int numThreads
+) {
+    MemoryScope scope(MEM_MESHING);
+    std::vector<std::vector<Polyline>> slices(std::max(count, 0));
+    glm::vec3 normal = glm::normalize(glm::cross(plane.u, plane.v));
+
+    if (numThreads <= 0)
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    numThreads = std::min(numThreads, std::max(count, 1));
+
+    // Threads pull slice indices until all slices are done
+    std::atomic<int> nextSlice(0);
+    auto worker = [&]() {
+        for (int i = nextSlice++; i < count; i = nextSlice++) {
+            SlicePlane slice = plane;
+            slice.origin += normal * (spacing * i);
+            slices[i] = marching_squares(f, isovalue, slice, stepsize);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    return slices;
+}
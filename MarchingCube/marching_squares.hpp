@@ -0,0 +1,69 @@
+// marching_squares.hpp
+// This header declares a Marching Squares engine for extracting 2D iso-contours on planar slices
+// through the same scalar fields used by marching_cubes(). Contours are returned as polylines
+// built by chaining the per-cell segments through their shared grid edges.
+
+#ifndef MARCHING_SQUARES_HPP
+#define MARCHING_SQUARES_HPP
+
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+
+// A rectangular region of a plane in which contours are extracted.
+// The sampled points are origin + s * u + t * v for s in [0, width] and t in [0, height].
+struct SlicePlane {
+    glm::vec3 origin; // Corner of the sampled rectangle
+    glm::vec3 u;      // First in-plane direction (unit length)
+    glm::vec3 v;      // Second in-plane direction (unit length, perpendicular to u)
+    float width;      // Extent along u
+    float height;     // Extent along v
+};
+
+// A connected contour. Closed contours repeat their first point at the end.
+typedef std::vector<glm::vec3> Polyline;
+
+// Builds an axis-aligned slice covering [min, max] in the two other axes.
+// Parameters:
+// - axis: The axis normal to the plane (0 = x, 1 = y, 2 = z).
+// - offset: The position of the plane along that axis.
+// - min, max: The bounds of the slice in the in-plane axes.
+// Returns: The slice plane.
+SlicePlane axis_aligned_plane(int axis, float offset, float min, float max);
+
+// Extracts the iso-contours of a scalar field on a single plane.
+// Parameters:
+// - f: A scalar field function that takes (x, y, z) as input and returns a scalar value.
+// - isovalue: The iso-contour value to extract.
+// - plane: The slice to sample.
+// - stepsize: The step size for sampling the plane.
+// Returns: The contours as chained polylines.
+std::vector<Polyline> marching_squares(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    const SlicePlane& plane,
+    float stepsize
+);
+
+// Extracts the iso-contours on a stack of parallel slices, distributing slices over threads.
+// Slice i is the given plane translated by i * spacing along its normal (cross(u, v)).
+// Parameters:
+// - f: A scalar field function; it is called concurrently from several threads.
+// - isovalue: The iso-contour value to extract.
+// - plane: The first slice.
+// - spacing: The distance between consecutive slices.
+// - count: The number of slices.
+// - stepsize: The step size for sampling each slice.
+// - numThreads: Number of worker threads (0 = hardware concurrency).
+// Returns: One list of polylines per slice, in slice order.
+std::vector<std::vector<Polyline>> marching_squares_slices(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    const SlicePlane& plane,
+    float spacing,
+    int count,
+    float stepsize,
+    int numThreads = 0
+);
+
+#endif // MARCHING_SQUARES_HPP
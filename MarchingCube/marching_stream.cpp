@@ -0,0 +1,47 @@
+// marching_stream.cpp
+// This file implements the coroutine-based streaming extraction declared in marching_stream.hpp.
+// The parameters are taken by value because the coroutine frame outlives the call.
+
+#include "marching_stream.hpp"
+#include "marching_kernel.hpp"
+#include <vector>
+
+// Sweeps the lattice slab by slab and yields every row that produced triangles
+Generator<TriangleRow> marching_rows(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    Lattice lattice
+) {
+    MarchingWorkspace workspace;
+    std::vector<float> rowVertices; // Reused for every row
+    const int nz = lattice.cells.z + 1;
+
+    begin_sweep(lattice, f, workspace, 0);
+    for (int x = 0; x < lattice.cells.x; ++x) {
+        begin_slab(lattice, f, workspace, x);
+        for (int y = 0; y < lattice.cells.y; ++y) {
+            rowVertices.clear();
+            march_row(lattice, isovalue, workspace, x, y,
+                      [&](int, int, int z, int cubeIndex, const glm::vec3* pos, const float* val) {
+                          emit_cached_triangles(workspace, y, z, cubeIndex, pos, val, isovalue, nz, rowVertices);
+                      });
+            if (!rowVertices.empty())
+                co_yield TriangleRow{x, y, std::span<const float>(rowVertices)};
+        }
+        end_slab(workspace);
+    }
+}
+
+// Unpacks the rows into single triangles
+Generator<Triangle> marching_triangles(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    Lattice lattice
+) {
+    for (const TriangleRow& row : marching_rows(std::move(f), isovalue, lattice)) {
+        for (size_t i = 0; i + 9 <= row.vertices.size(); i += 9) {
+            const float* t = &row.vertices[i];
+            co_yield Triangle{{glm::vec3(t[0], t[1], t[2]), glm::vec3(t[3], t[4], t[5]), glm::vec3(t[6], t[7], t[8])}};
+        }
+    }
+}
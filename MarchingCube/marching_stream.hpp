@@ -0,0 +1,49 @@
+// marching_stream.hpp
+// This header declares lazy, streaming variants of marching_cubes() built on C++20 coroutines
+// (see generator.hpp). The lattice is swept only as far as the consumer pulls: stopping after the
+// first N triangles, or reducing the mesh to a bounding box, never holds the full mesh in memory.
+// Requires -std=c++20.
+
+#ifndef MARCHING_STREAM_HPP
+#define MARCHING_STREAM_HPP
+
+#include "marching.hpp"
+#include "generator.hpp"
+#include <functional>
+#include <span>
+#include <glm/glm.hpp>
+
+// One triangle of the mesh.
+struct Triangle {
+    glm::vec3 v[3];
+};
+
+// The triangles of one z-row of cells (all cells (x, y, z) for 0 <= z < cells.z).
+struct TriangleRow {
+    int x, y;                        // Row of the lattice
+    std::span<const float> vertices; // Same layout as marching_cubes(); valid until the next pull
+};
+
+// Streams the triangles of the isosurface one row of cells at a time. Rows without triangles are
+// skipped; the traversal is paused between pulls.
+// Parameters:
+// - f: Scalar field; it is copied into the coroutine, so it must stay valid only as long as what it captures.
+// - isovalue: The isosurface value.
+// - lattice: The sampling lattice.
+// Returns: A generator of rows, in the same order as marching_cubes().
+Generator<TriangleRow> marching_rows(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    Lattice lattice
+);
+
+// Streams the triangles of the isosurface one at a time, in the same order as marching_cubes().
+// Parameters: Same as marching_rows().
+// Returns: A generator of triangles.
+Generator<Triangle> marching_triangles(
+    std::function<float(float, float, float)> f,
+    float isovalue,
+    Lattice lattice
+);
+
+#endif // MARCHING_STREAM_HPP
@@ -0,0 +1,231 @@
+// memory.cpp
+// This file implements the memory accounting declared in memory.hpp: the replacement global
+// operator new / delete that charge allocations to the calling thread's tag, the counters, and
+// the table of GL object sizes.
+//
+// Every allocation carries a 16-byte header in front of the returned pointer with its size, its
+// tag and the distance back to the start of the underlying block, so operator delete can credit
+// the right tag without a lookup. The counters are relaxed atomics, one cache line per tag.
+
+#include "memory.hpp"
+#include "log.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#ifndef MEMORY_TRACKING
+#define MEMORY_TRACKING 1
+#endif
+
+namespace {
+
+struct alignas(64) Counters {
+    std::atomic<std::size_t> current{0};
+    std::atomic<std::size_t> peak{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> live{0};
+
+    void charge(std::size_t bytes) {
+        std::size_t now = current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        std::size_t high = peak.load(std::memory_order_relaxed);
+        while (now > high && !peak.compare_exchange_weak(high, now, std::memory_order_relaxed)) {
+        }
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        live.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void credit(std::size_t bytes) {
+        current.fetch_sub(bytes, std::memory_order_relaxed);
+        live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    MemoryUsage read() const {
+        MemoryUsage usage;
+        usage.current = current.load(std::memory_order_relaxed);
+        usage.peak = peak.load(std::memory_order_relaxed);
+        usage.allocations = allocations.load(std::memory_order_relaxed);
+        usage.live = live.load(std::memory_order_relaxed);
+        return usage;
+    }
+};
+
+Counters counters[MEM_TAG_COUNT];
+Counters cpuTotal; // Sum of the CPU tags, with its own peak
+
+thread_local MemoryTag currentTag = MEM_OTHER;
+
+// Sizes of the live GL objects, per tag
+struct GlObjects {
+    std::mutex mutex;
+    std::unordered_map<unsigned int, std::size_t> sizes[MEM_TAG_COUNT];
+};
+
+GlObjects& glObjects() {
+    static GlObjects objects; // Constructed on first use, after operator new is usable
+    return objects;
+}
+
+double toMB(std::size_t bytes) {
+    return std::round(bytes / (1024.0 * 1024.0) * 100.0) / 100.0;
+}
+
+#if MEMORY_TRACKING
+
+// Placed right before the pointer returned to the caller
+struct alignas(16) Header {
+    std::size_t size;
+    std::uint32_t tag;
+    std::uint32_t offset; // Bytes from the start of the block to the returned pointer
+};
+static_assert(sizeof(Header) == 16, "The header must keep 16-byte alignment");
+
+void* trackedAlloc(std::size_t size, std::size_t alignment, bool nothrow) {
+    std::size_t offset = alignment > sizeof(Header) ? alignment : sizeof(Header);
+    for (;;) {
+        void* block;
+        if (alignment > sizeof(Header)) {
+            std::size_t total = (size + offset + alignment - 1) / alignment * alignment;
+            block = std::aligned_alloc(alignment, total);
+        } else {
+            block = std::malloc(size + offset);
+        }
+        if (block) {
+            char* p = static_cast<char*>(block) + offset;
+            Header* header = reinterpret_cast<Header*>(p) - 1;
+            header->size = size;
+            header->tag = currentTag;
+            header->offset = static_cast<std::uint32_t>(offset);
+            counters[currentTag].charge(size);
+            cpuTotal.charge(size);
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            if (nothrow) return nullptr;
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void trackedFree(void* p) {
+    if (!p) return;
+    Header* header = static_cast<Header*>(p) - 1;
+    counters[header->tag].credit(header->size);
+    cpuTotal.credit(header->size);
+    std::free(static_cast<char*>(p) - header->offset);
+}
+
+void* nothrowAlloc(std::size_t size, std::size_t alignment) noexcept {
+    try {
+        return trackedAlloc(size, alignment, true);
+    } catch (...) { // Thrown by a new handler
+        return nullptr;
+    }
+}
+
+#endif // MEMORY_TRACKING
+
+} // namespace
+
+#if MEMORY_TRACKING
+
+// Replacement allocation functions; every form ends up in trackedAlloc / trackedFree
+void* operator new(std::size_t size) { return trackedAlloc(size, 0, false); }
+void* operator new[](std::size_t size) { return trackedAlloc(size, 0, false); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return nothrowAlloc(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return nothrowAlloc(size, 0); }
+void* operator new(std::size_t size, std::align_val_t al) { return trackedAlloc(size, static_cast<std::size_t>(al), false); }
+void* operator new[](std::size_t size, std::align_val_t al) { return trackedAlloc(size, static_cast<std::size_t>(al), false); }
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return nothrowAlloc(size, static_cast<std::size_t>(al)); }
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return nothrowAlloc(size, static_cast<std::size_t>(al)); }
+
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { trackedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { trackedFree(p); }
+
+#endif // MEMORY_TRACKING
+
+MemoryScope::MemoryScope(MemoryTag tag) : previous(currentTag) {
+    currentTag = tag;
+}
+
+MemoryScope::~MemoryScope() {
+    currentTag = previous;
+}
+
+MemoryTag memory_current_tag() {
+    return currentTag;
+}
+
+MemoryUsage memory_usage(MemoryTag tag) {
+    return counters[tag].read();
+}
+
+MemoryUsage memory_cpu_total() {
+    return cpuTotal.read();
+}
+
+const char* memory_tag_name(MemoryTag tag) {
+    static const char* names[MEM_TAG_COUNT] = {"other", "meshing", "normals", "bake", "export",
+                                               "GPU buffers", "GPU textures"};
+    return names[tag];
+}
+
+// The peak is only ever raised by charge(), so lowering it here may race with an allocation in
+// flight; that allocation's contribution shows up in the next report instead
+void memory_reset_peak() {
+    for (auto& tag : counters)
+        tag.peak.store(tag.current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    cpuTotal.peak.store(cpuTotal.current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// Logs the table; the counts of the GPU tags are glBufferData / glTexImage calls and live objects
+void memory_report() {
+    for (int tag = 0; tag < MEM_TAG_COUNT; ++tag) {
+        MemoryUsage usage = counters[tag].read();
+        if (usage.allocations == 0) continue;
+        LOG_INFO("Memory {}: {} MB now, {} MB peak, {} allocations, {} live",
+                 memory_tag_name(static_cast<MemoryTag>(tag)), toMB(usage.current), toMB(usage.peak),
+                 usage.allocations, usage.live);
+    }
+    MemoryUsage total = cpuTotal.read();
+    LOG_INFO("Memory CPU total: {} MB now, {} MB peak, {} allocations, {} live",
+             toMB(total.current), toMB(total.peak), total.allocations, total.live);
+}
+
+void memory_track_gl(MemoryTag tag, unsigned int id, std::size_t bytes) {
+    GlObjects& objects = glObjects();
+    std::lock_guard<std::mutex> lock(objects.mutex);
+    auto found = objects.sizes[tag].find(id);
+    if (found != objects.sizes[tag].end()) {
+        counters[tag].credit(found->second);
+        found->second = bytes;
+    } else {
+        objects.sizes[tag].emplace(id, bytes);
+    }
+    counters[tag].charge(bytes);
+}
+
+void memory_release_gl(MemoryTag tag, int count, const unsigned int* ids) {
+    GlObjects& objects = glObjects();
+    std::lock_guard<std::mutex> lock(objects.mutex);
+    for (int i = 0; i < count; ++i) {
+        auto found = objects.sizes[tag].find(ids[i]);
+        if (found == objects.sizes[tag].end()) continue;
+        counters[tag].credit(found->second);
+        objects.sizes[tag].erase(found);
+    }
+}
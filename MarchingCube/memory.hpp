@@ -0,0 +1,86 @@
+// memory.hpp
+// This header declares per-subsystem memory accounting. Every heap allocation made through operator
+// new (std::vector, std::string, ...) is charged to the tag of the calling thread, set with a
+// MemoryScope for the duration of a task, and credited back to the same tag when it is freed, on
+// whichever thread. GL buffers and textures are charged to their own tags by the code that sizes
+// them. Current bytes, peak bytes and allocation counts can be read or logged at any time.
+//
+// Usage:
+//     {
+//         MemoryScope scope(MEM_MESHING);
+//         vertices = marching_cubes(...); // Charged to MEM_MESHING until the vector is freed
+//     }
+//     memory_report();
+//
+// Build with -DMEMORY_TRACKING=0 to leave operator new alone; only the GL sizes are tracked then.
+
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+enum MemoryTag {
+    MEM_OTHER = 0,    // Anything outside a scope (startup, GL driver calls, logging)
+    MEM_MESHING,      // Extraction workspaces and vertex output
+    MEM_NORMALS,      // Normal computation
+    MEM_BAKE,         // Normal-map atlas and UVs
+    MEM_EXPORT,       // .ply writing
+    MEM_GPU_BUFFERS,  // GL buffer objects (tracked sizes, not CPU memory)
+    MEM_GPU_TEXTURES, // GL textures (tracked sizes, not CPU memory)
+    MEM_TAG_COUNT
+};
+
+// Usage of one tag
+struct MemoryUsage {
+    std::size_t current = 0;        // Bytes allocated now
+    std::size_t peak = 0;           // Highest value of current since start (or memory_reset_peak)
+    std::uint64_t allocations = 0;  // Allocations made since start
+    std::uint64_t live = 0;         // Allocations not freed yet
+};
+
+// Sets the tag of the calling thread's allocations until the scope ends, then restores the previous one.
+// Threads start in MEM_OTHER, so workers open their own scope.
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryTag tag);
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemoryTag previous;
+};
+
+// Returns the tag allocations of the calling thread are charged to
+MemoryTag memory_current_tag();
+
+// Returns the usage of one tag
+MemoryUsage memory_usage(MemoryTag tag);
+
+// Returns the usage summed over the CPU tags (the GPU tags are left out); its peak is the peak of the sum
+MemoryUsage memory_cpu_total();
+
+// Returns the name of a tag, as printed by memory_report()
+const char* memory_tag_name(MemoryTag tag);
+
+// Sets the peak of every tag to its current value, e.g. before measuring one job
+void memory_reset_peak();
+
+// Logs one line per tag with current and peak MB and the allocation counts
+void memory_report();
+
+// Records the size of a GL object's storage, replacing any size recorded for it before
+// (glBufferData and glTexImage* reallocate)
+// Parameters:
+// - tag: MEM_GPU_BUFFERS or MEM_GPU_TEXTURES (buffer and texture names are separate)
+// - id: The GL object name
+// - bytes: Size of its storage
+void memory_track_gl(MemoryTag tag, unsigned int id, std::size_t bytes);
+
+// Forgets the GL objects in ids, typically right before glDeleteBuffers / glDeleteTextures.
+// Names that were never tracked are ignored.
+void memory_release_gl(MemoryTag tag, int count, const unsigned int* ids);
+
+#endif // MEMORY_HPP
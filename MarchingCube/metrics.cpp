@@ -0,0 +1,277 @@
+// metrics.cpp
+// This file implements the metrics registry and the Prometheus text exporter declared in metrics.hpp.
+
+#include "metrics.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+Histogram::Histogram(std::vector<double> bounds)
+    : upper(std::move(bounds)), buckets(new std::atomic<std::uint64_t>[upper.size() + 1]) {
+    std::sort(upper.begin(), upper.end());
+    for (std::size_t i = 0; i <= upper.size(); ++i)
+        buckets[i].store(0, std::memory_order_relaxed);
+}
+
+// Bucket bounds are inclusive ("le"), so a value equal to a bound goes into that bucket
+void Histogram::observe(double v) {
+    std::size_t i = std::lower_bound(upper.begin(), upper.end(), v) - upper.begin();
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sumValue.fetch_add(v, std::memory_order_relaxed);
+}
+
+namespace {
+
+enum class MetricType { Counter, Gauge, Histogram };
+
+// One labelled time series of a family
+struct Series {
+    std::string labels;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+};
+
+// All series sharing a name, exported under one # HELP / # TYPE header
+struct Family {
+    std::string name, help;
+    MetricType type;
+    std::vector<Series> series;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Family>> families; // In registration order
+    std::vector<std::function<void()>> collectors;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Returns the series with the given labels, creating the family and the series as needed.
+// A name reused with another type gets a series that is never exported rather than a crash.
+Series& findSeries(const std::string& name, const std::string& help, MetricType type, const std::string& labels) {
+    Registry& r = registry();
+    Family* family = nullptr;
+    for (auto& f : r.families) {
+        if (f->name == name) family = f.get();
+    }
+    if (family && family->type != type) {
+        LOG_ERROR("Metric {} registered again with a different type", name);
+        static std::vector<std::unique_ptr<Family>> orphans;
+        orphans.push_back(std::make_unique<Family>(Family{name, help, type, {}}));
+        family = orphans.back().get();
+    }
+    if (!family) {
+        r.families.push_back(std::make_unique<Family>(Family{name, help, type, {}}));
+        family = r.families.back().get();
+    }
+    for (auto& s : family->series) {
+        if (s.labels == labels) return s;
+    }
+    family->series.push_back(Series{labels, nullptr, nullptr, nullptr});
+    return family->series.back();
+}
+
+const char* typeName(MetricType type) {
+    switch (type) {
+        case MetricType::Counter: return "counter";
+        case MetricType::Gauge: return "gauge";
+        default: return "histogram";
+    }
+}
+
+std::string formatNumber(double v) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", v);
+    return buffer;
+}
+
+// "name{labels}" or "name{labels,extra}", without braces when both are empty
+std::string seriesName(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    std::string all = labels;
+    if (!extra.empty()) all += (all.empty() ? "" : ",") + extra;
+    return all.empty() ? name : name + "{" + all + "}";
+}
+
+} // namespace
+
+// Series vectors only grow under the registry lock and the metrics live behind unique_ptrs, so the
+// references handed out stay valid while other metrics are registered
+Counter& metrics_counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    Series& s = findSeries(name, help, MetricType::Counter, labels);
+    if (!s.counter) s.counter = std::make_unique<Counter>();
+    return *s.counter;
+}
+
+Gauge& metrics_gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    Series& s = findSeries(name, help, MetricType::Gauge, labels);
+    if (!s.gauge) s.gauge = std::make_unique<Gauge>();
+    return *s.gauge;
+}
+
+Histogram& metrics_histogram(const std::string& name, const std::string& help, std::initializer_list<double> bounds,
+                             const std::string& labels) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    Series& s = findSeries(name, help, MetricType::Histogram, labels);
+    if (!s.histogram) s.histogram = std::make_unique<Histogram>(std::vector<double>(bounds));
+    return *s.histogram;
+}
+
+void metrics_on_collect(std::function<void()> collect) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().collectors.push_back(std::move(collect));
+}
+
+// Histogram buckets are stored per bucket and written cumulatively, as the format requires
+std::string metrics_text() {
+    Registry& r = registry();
+    std::vector<std::function<void()>> collectors;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        collectors = r.collectors;
+    }
+    for (auto& collect : collectors) // Outside the lock: they may register gauges
+        collect();
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::string out;
+    for (const auto& family : r.families) {
+        out += "# HELP " + family->name + " " + family->help + "\n";
+        out += "# TYPE " + family->name + " " + typeName(family->type) + "\n";
+        for (const auto& s : family->series) {
+            if (s.counter) {
+                out += seriesName(family->name, s.labels) + " " + std::to_string(s.counter->value()) + "\n";
+            } else if (s.gauge) {
+                out += seriesName(family->name, s.labels) + " " + formatNumber(s.gauge->value()) + "\n";
+            } else if (s.histogram) {
+                const Histogram& h = *s.histogram;
+                std::uint64_t cumulative = 0;
+                for (std::size_t i = 0; i <= h.bounds().size(); ++i) {
+                    cumulative += h.bucketCount(i);
+                    std::string le = i < h.bounds().size() ? formatNumber(h.bounds()[i]) : "+Inf";
+                    out += seriesName(family->name + "_bucket", s.labels, "le=\"" + le + "\"") + " " +
+                           std::to_string(cumulative) + "\n";
+                }
+                // The count is the +Inf bucket, so _count and the buckets agree even when an
+                // observation lands while they are being read
+                out += seriesName(family->name + "_sum", s.labels) + " " + formatNumber(h.sum()) + "\n";
+                out += seriesName(family->name + "_count", s.labels) + " " + std::to_string(cumulative) + "\n";
+            }
+        }
+    }
+    return out;
+}
+
+bool metrics_write_file(const std::string& path) {
+    std::string text = metrics_text();
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "w");
+    if (!file) {
+        LOG_WARN("Could not write metrics to {}", temporary);
+        return false;
+    }
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        LOG_WARN("Could not write metrics to {}", path);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Constructor: binds the endpoint (loopback only) and starts the export thread
+MetricsExporter::MetricsExporter(const std::string& path, int port, double intervalSeconds)
+    : path(path), intervalSeconds(intervalSeconds) {
+    if (port > 0) {
+        listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (listenSocket < 0 || bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listenSocket, 8) != 0) {
+            LOG_WARN("Could not serve metrics on 127.0.0.1:{}", port);
+            if (listenSocket >= 0) close(listenSocket);
+            listenSocket = -1;
+        } else {
+            LOG_INFO("Serving metrics on http://127.0.0.1:{}/metrics", port);
+        }
+    }
+    if (!path.empty() || listenSocket >= 0)
+        thread = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+    stopping = true;
+    if (thread.joinable()) thread.join();
+    if (listenSocket >= 0) close(listenSocket);
+    if (!path.empty()) metrics_write_file(path); // Final values of the session
+}
+
+// Export loop: waits for connections in short slices so that file writes and shutdown stay on time
+void MetricsExporter::run() {
+    using Clock = std::chrono::steady_clock;
+    auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(intervalSeconds));
+    Clock::time_point nextWrite = Clock::now();
+    while (!stopping) {
+        if (!path.empty() && Clock::now() >= nextWrite) {
+            metrics_write_file(path);
+            nextWrite += interval;
+            if (nextWrite < Clock::now()) nextWrite = Clock::now() + interval; // Do not catch up after a stall
+        }
+        pollfd listening{listenSocket, POLLIN, 0};
+        int ready = poll(&listening, listenSocket >= 0 ? 1 : 0, 100);
+        if (ready > 0 && (listening.revents & POLLIN))
+            serveOne();
+    }
+}
+
+// Answers one request: any GET returns the metrics, anything else 405. One connection at a time;
+// a scraper that stalls for over a second is dropped.
+void MetricsExporter::serveOne() {
+    int client = accept(listenSocket, nullptr, nullptr);
+    if (client < 0) return;
+    timeval timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        request.append(buffer, static_cast<std::size_t>(n));
+    }
+
+    std::string response;
+    if (request.compare(0, 4, "GET ") == 0) {
+        std::string body = metrics_text();
+        response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                   std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    } else {
+        response = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+    for (std::size_t sent = 0; sent < response.size();) {
+        ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += static_cast<std::size_t>(n);
+    }
+    close(client);
+}
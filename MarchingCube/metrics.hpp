@@ -0,0 +1,123 @@
+// metrics.hpp
+// This header declares a small metrics registry for long-running sessions: counters, gauges and
+// histograms that the render loop and the meshing code update on their hot paths, and an exporter
+// that periodically writes all of them in the Prometheus text format, to a file (for the node
+// exporter's textfile collector) and/or to an HTTP endpoint on localhost.
+//
+// Metrics are registered once, by name, and then updated through the returned reference with
+// relaxed atomic operations only (no locks, no allocation). The registry lock is taken only when
+// registering and when exporting.
+//
+// Usage:
+//     static Counter& jobs = metrics_counter("marching_meshing_jobs_total", "Meshing jobs run");
+//     jobs.add();
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Monotonic count of events or units (jobs, bytes)
+class Counter {
+public:
+    void add(std::uint64_t n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> count{0};
+};
+
+// Value that goes up and down (triangles on screen, bytes in use)
+class Gauge {
+public:
+    void set(double v) { current.store(v, std::memory_order_relaxed); }
+    double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current{0.0};
+};
+
+// Distribution of observations over fixed buckets (frame times, job durations)
+class Histogram {
+public:
+    // Parameters:
+    // - bounds: Upper bounds of the buckets, ascending; values above the last one are only
+    //   counted in the implicit +Inf bucket
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double v);
+
+    const std::vector<double>& bounds() const { return upper; }
+    // Number of observations in bucket i (not cumulative); bucket bounds().size() is +Inf
+    std::uint64_t bucketCount(std::size_t i) const { return buckets[i].load(std::memory_order_relaxed); }
+    std::uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    double sum() const { return sumValue.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double> upper;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> buckets;
+    std::atomic<std::uint64_t> total{0};
+    std::atomic<double> sumValue{0.0};
+};
+
+// Functions to register a metric, or return the existing one with the same name and labels.
+// The returned reference stays valid until the program exits.
+// Parameters:
+// - name: Prometheus metric name (counters should end in _total)
+// - help: One-line description for the # HELP line
+// - labels: Optional label set without braces, e.g. "tag=\"meshing\""
+Counter& metrics_counter(const std::string& name, const std::string& help, const std::string& labels = "");
+Gauge& metrics_gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+Histogram& metrics_histogram(const std::string& name, const std::string& help, std::initializer_list<double> bounds,
+                             const std::string& labels = "");
+
+// Registers a function run right before every export, to refresh gauges that are sampled rather
+// than updated as they change (memory usage, for example)
+void metrics_on_collect(std::function<void()> collect);
+
+// Returns every registered metric in the Prometheus text exposition format
+std::string metrics_text();
+
+// Writes metrics_text() to a file, through a temporary file renamed over it so that readers never
+// see a partial export
+// Returns:
+// - bool: True on success
+bool metrics_write_file(const std::string& path);
+
+// Background exporter: writes the metrics file every interval and/or answers HTTP GETs on
+// 127.0.0.1:port with the current metrics, until destroyed (the file is written once more then)
+class MetricsExporter {
+public:
+    // Constructor
+    // Parameters:
+    // - path: File to write, or "" for none
+    // - port: Port of the HTTP endpoint on localhost, or 0 for none
+    // - intervalSeconds: Time between file writes
+    MetricsExporter(const std::string& path, int port, double intervalSeconds = 10.0);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Returns true if the HTTP endpoint is listening (false if it was not requested or bind failed)
+    bool serving() const { return listenSocket >= 0; }
+
+private:
+    void run();
+    void serveOne();
+
+    std::string path;
+    double intervalSeconds;
+    int listenSocket = -1;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
+
+#endif // METRICS_HPP
@@ -0,0 +1,152 @@
+// normal_bake.cpp
+// This file implements the normal-map baker declared in normal_bake.hpp.
+
+#include "normal_bake.hpp"
+#include <glm/glm.hpp>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "log.hpp"
+#include "memory.hpp"
+
+// Chart layout inside a grid square of size s (in texels): triangle A occupies the lower-left half,
+// triangle B the upper-right half, with a border of chartPadding texels and a gap of chartGap
+// texels along the diagonal.
+static const float chartPadding = 1.0f;
+static const float chartGap = 1.5f;
+
+// Returns the corners of one chart (triangle 0 or 1 of a square) in texels, relative to the square
+static void chartCorners(int half, float s, glm::vec2 uv[3]) {
+    float p = chartPadding, g = chartGap;
+    if (half == 0) {
+        uv[0] = glm::vec2(p, p);
+        uv[1] = glm::vec2(s - p - g, p);
+        uv[2] = glm::vec2(p, s - p - g);
+    } else {
+        uv[0] = glm::vec2(s - p, s - p);
+        uv[1] = glm::vec2(p + g, s - p);
+        uv[2] = glm::vec2(s - p, p + g);
+    }
+}
+
+// Bakes the normal map, one band of texel rows per thread at a time
+NormalMap bake_normal_map(
+    const std::vector<float>& vertices,
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    int resolution,
+    float gradientStep,
+    int numThreads
+) {
+    MemoryScope scope(MEM_BAKE);
+    NormalMap map;
+    int numTriangles = static_cast<int>(vertices.size() / 9);
+    if (numTriangles == 0 || resolution <= 0) return map;
+
+    // Grid of squares holding two triangles each
+    int numSquares = (numTriangles + 1) / 2;
+    int squaresPerRow = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numSquares))));
+    int squareSize = resolution / squaresPerRow;
+    if (squareSize < 6) {
+        LOG_ERROR("Normal map of {}^2 texels is too small for {} triangles", resolution, numTriangles);
+        return map;
+    }
+
+    map.width = resolution;
+    map.height = resolution;
+    map.texels.assign(static_cast<size_t>(resolution) * resolution * 3, 128);
+
+    // Texture coordinates of every vertex
+    map.uvs.resize(static_cast<size_t>(numTriangles) * 6);
+    for (int t = 0; t < numTriangles; ++t) {
+        int square = t / 2;
+        glm::vec2 origin(static_cast<float>((square % squaresPerRow) * squareSize),
+                         static_cast<float>((square / squaresPerRow) * squareSize));
+        glm::vec2 uv[3];
+        chartCorners(t % 2, static_cast<float>(squareSize), uv);
+        for (int k = 0; k < 3; ++k) {
+            map.uvs[t * 6 + k * 2]     = (origin.x + uv[k].x) / resolution;
+            map.uvs[t * 6 + k * 2 + 1] = (origin.y + uv[k].y) / resolution;
+        }
+    }
+
+    auto vertex = [&](int t, int k) {
+        return glm::vec3(vertices[t * 9 + k * 3], vertices[t * 9 + k * 3 + 1], vertices[t * 9 + k * 3 + 2]);
+    };
+    auto field = [&](const glm::vec3& p) { return f(p.x, p.y, p.z); };
+    auto gradient = [&](const glm::vec3& p) {
+        float h = gradientStep;
+        return glm::vec3(field(p + glm::vec3(h, 0, 0)) - field(p - glm::vec3(h, 0, 0)),
+                         field(p + glm::vec3(0, h, 0)) - field(p - glm::vec3(0, h, 0)),
+                         field(p + glm::vec3(0, 0, h)) - field(p - glm::vec3(0, 0, h))) / (2.0f * h);
+    };
+
+    // Normal of the isosurface near the point of triangle t under texel centre c (relative to the square)
+    auto bakeTexel = [&](int t, const glm::vec2& c) {
+        glm::vec2 uv[3];
+        chartCorners(t % 2, static_cast<float>(squareSize), uv);
+
+        // Barycentric coordinates, clamped so that gutter texels take the value of the nearest edge
+        glm::vec2 e1 = uv[1] - uv[0], e2 = uv[2] - uv[0], d = c - uv[0];
+        float det = e1.x * e2.y - e1.y * e2.x;
+        float b1 = (d.x * e2.y - d.y * e2.x) / det;
+        float b2 = (e1.x * d.y - e1.y * d.x) / det;
+        float b0 = 1.0f - b1 - b2;
+        b0 = std::max(b0, 0.0f);
+        b1 = std::max(b1, 0.0f);
+        b2 = std::max(b2, 0.0f);
+        float sum = b0 + b1 + b2;
+        glm::vec3 p = (b0 * vertex(t, 0) + b1 * vertex(t, 1) + b2 * vertex(t, 2)) / sum;
+
+        // The coarse triangle only approximates the surface: a few Newton steps move the point onto it
+        glm::vec3 g = gradient(p);
+        for (int i = 0; i < 3; ++i) {
+            float len2 = glm::dot(g, g);
+            if (len2 < 1e-12f) break;
+            p -= (field(p) - isovalue) / len2 * g;
+            g = gradient(p);
+        }
+
+        // Flat-shaded normal where the gradient vanishes; it points the same way as compute_normals()
+        if (glm::dot(g, g) < 1e-12f)
+            g = glm::cross(vertex(t, 1) - vertex(t, 0), vertex(t, 2) - vertex(t, 0));
+        return glm::normalize(g);
+    };
+
+    if (numThreads <= 0)
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    // Threads pull bands of rows until the atlas is done
+    const int bandRows = 16;
+    std::atomic<int> nextBand(0);
+    auto worker = [&]() {
+        MemoryScope scope(MEM_BAKE);
+        for (int row0 = bandRows * nextBand++; row0 < resolution; row0 = bandRows * nextBand++) {
+            for (int j = row0; j < std::min(row0 + bandRows, resolution); ++j) {
+                int squareY = j / squareSize;
+                if (squareY >= squaresPerRow) break;
+                for (int i = 0; i < squaresPerRow * squareSize; ++i) {
+                    int square = squareY * squaresPerRow + i / squareSize;
+                    glm::vec2 c(i % squareSize + 0.5f, j % squareSize + 0.5f);
+                    int t = square * 2 + (c.x + c.y < squareSize ? 0 : 1);
+                    if (t >= numTriangles) continue;
+
+                    glm::vec3 n = bakeTexel(t, c);
+                    unsigned char* texel = &map.texels[(static_cast<size_t>(j) * resolution + i) * 3];
+                    for (int k = 0; k < 3; ++k)
+                        texel[k] = static_cast<unsigned char>(std::lround((n[k] * 0.5f + 0.5f) * 255.0f));
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    return map;
+}
@@ -0,0 +1,40 @@
+// normal_bake.hpp
+// This header declares a normal-map baker for coarse Marching Cubes meshes.
+// Every triangle gets its own chart in a texture atlas; each texel of a chart is mapped back to a
+// point on its triangle, pulled onto the true isosurface, and stores the normalized field gradient
+// there. Rendering the coarse mesh with this map restores the shading detail of a much finer mesh.
+
+#ifndef NORMAL_BAKE_HPP
+#define NORMAL_BAKE_HPP
+
+#include <vector>
+#include <functional>
+
+// A baked object-space normal map and the texture coordinates that go with it.
+struct NormalMap {
+    int width = 0, height = 0;
+    std::vector<unsigned char> texels; // RGB8, normal * 0.5 + 0.5; row 0 is v = 0
+    std::vector<float> uvs;            // Two per mesh vertex
+};
+
+// Generates texture coordinates for a mesh and bakes the field's normals into a texture.
+// Triangles are packed in pairs into the squares of a grid covering the atlas, each with a gutter
+// so that bilinear filtering never mixes neighbouring triangles (do not mipmap the result).
+// Parameters:
+// - vertices: A vector of vertices in the layout of marching_cubes().
+// - f: The scalar field the mesh was extracted from; called concurrently, so it must be thread-safe.
+// - isovalue: The isovalue the mesh was extracted at.
+// - resolution: Width and height of the atlas in texels.
+// - gradientStep: Step of the central differences used for the gradient.
+// - numThreads: Number of threads baking bands of texel rows (0 = hardware concurrency).
+// Returns: The normal map; texels is empty if the mesh has no triangles.
+NormalMap bake_normal_map(
+    const std::vector<float>& vertices,
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    int resolution = 2048,
+    float gradientStep = 1e-3f,
+    int numThreads = 0
+);
+
+#endif // NORMAL_BAKE_HPP
@@ -0,0 +1,128 @@
+// progressive.cpp
+// This file implements the coarse-to-fine mesher declared in progressive.hpp.
+
+#include "progressive.hpp"
+#include "marching.hpp"
+#include "marching_kernel.hpp" // Block extraction on the full lattice
+#include "log.hpp"
+#include "memory.hpp"
+#include "metrics.hpp"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// Constructor: splits the lattice into regions of a whole number of cells each
+ProgressiveMesher::ProgressiveMesher(std::function<float(float, float, float)> f, float isovalue,
+                                     float min, float max, float stepsize,
+                                     int regionsPerAxis, int coarseFactor)
+    : f(f), isovalue(isovalue), min(min), stepsize(stepsize),
+      regionsPerAxis(std::max(regionsPerAxis, 1)), coarseFactor(std::max(coarseFactor, 1)) {
+    lattice = make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(stepsize));
+    cellsPerRegion = (lattice.cells.x + this->regionsPerAxis - 1) / this->regionsPerAxis;
+    regionSize = cellsPerRegion * stepsize;
+}
+
+// Stops the workers and joins them
+ProgressiveMesher::~ProgressiveMesher() {
+    stopping = true;
+    for (auto& thread : workers)
+        thread.join();
+}
+
+// Extracts one region as a block of cells of the full lattice, so that the fine meshes of
+// neighbouring regions meet in bit-identical vertices
+// Parameters:
+// - region: The region index.
+// - factor: Step multiplier (1 for the full-resolution mesh, coarseFactor for the preview).
+RegionMesh ProgressiveMesher::extractRegion(int region, int factor) const {
+    static Counter& jobs = metrics_counter("marching_meshing_jobs_total", "Meshing jobs run", "engine=\"progressive\"");
+    static Histogram& seconds = metrics_histogram("marching_meshing_seconds", "Duration of meshing jobs",
+                                                  {0.001, 0.01, 0.1, 0.5, 1, 5, 30, 120}, "engine=\"progressive\"");
+    auto start = std::chrono::steady_clock::now();
+    MemoryScope scope(MEM_MESHING);
+
+    int r = regionsPerAxis;
+    glm::ivec3 index(region / (r * r), (region / r) % r, region % r);
+
+    RegionMesh mesh;
+    mesh.region = region;
+    mesh.fine = (factor == 1);
+
+    // The last region along an axis only covers the cells that are left
+    glm::ivec3 begin = index * cellsPerRegion;
+    glm::ivec3 cells;
+    for (int axis = 0; axis < 3; ++axis) {
+        int regionCells = std::min(cellsPerRegion, lattice.cells[axis] - begin[axis]);
+        if (regionCells <= 0) return mesh; // More regions than cells
+        cells[axis] = (regionCells + factor - 1) / factor;
+    }
+
+    MarchingWorkspace workspace;
+    march_block(lattice, f, isovalue, workspace, begin, cells, factor, mesh.vertices);
+    mesh.normals = compute_normals(mesh.vertices);
+
+    jobs.add();
+    seconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return mesh;
+}
+
+// Produces the coarse preview and starts the refinement workers
+void ProgressiveMesher::start(const glm::vec3& eye, int numThreads) {
+    int numRegions = regionCount();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int region = 0; region < numRegions; ++region)
+            completed.push_back(extractRegion(region, coarseFactor));
+        remaining = numRegions;
+    }
+
+    // Front-to-back: nearest region centre first
+    int r = regionsPerAxis;
+    auto distance = [&](int region) {
+        glm::vec3 centre = glm::vec3(region / (r * r), (region / r) % r, region % r) * regionSize
+                         + glm::vec3(min + 0.5f * regionSize);
+        return glm::length(centre - eye);
+    };
+    order.resize(numRegions);
+    for (int region = 0; region < numRegions; ++region)
+        order[region] = region;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return distance(a) < distance(b); });
+
+    if (numThreads <= 0)
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int t = 0; t < numThreads; ++t)
+        workers.emplace_back(&ProgressiveMesher::worker, this);
+}
+
+// Worker loop: refines regions in front-to-back order until all are done or the mesher is destroyed
+void ProgressiveMesher::worker() {
+    MemoryScope scope(MEM_MESHING);
+    for (int i = next++; i < static_cast<int>(order.size()) && !stopping; i = next++) {
+        RegionMesh mesh = extractRegion(order[i], 1);
+        LOG_DEBUG("Refined region {} ({} of {}): {} triangles", mesh.region, i + 1, order.size(),
+                  mesh.vertices.size() / 9);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed.push_back(std::move(mesh));
+        }
+        if (onCompleted) onCompleted();
+    }
+}
+
+// Hands the finished meshes to the render thread
+bool ProgressiveMesher::poll(std::vector<RegionMesh>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (completed.empty()) return false;
+    for (auto& mesh : completed) {
+        if (mesh.fine) --remaining;
+        out.push_back(std::move(mesh));
+    }
+    completed.clear();
+    return true;
+}
+
+// Returns true once every full-resolution region has been polled
+bool ProgressiveMesher::finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return remaining == 0 && !order.empty();
+}
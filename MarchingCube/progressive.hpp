@@ -0,0 +1,85 @@
+// progressive.hpp
+// This header declares a progressive, coarse-to-fine Marching Cubes mesher for the viewer.
+// The domain is split into a grid of regions. A coarse mesh of every region is produced right away
+// so the first frame has something to show; worker threads then re-extract the regions at full
+// resolution, nearest to the camera first, and hand each finished region back to the render thread.
+
+#ifndef PROGRESSIVE_MARCHING_HPP
+#define PROGRESSIVE_MARCHING_HPP
+
+#include "marching.hpp"
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <glm/glm.hpp>
+
+// The mesh of one region at one level of detail.
+struct RegionMesh {
+    int region;                 // Region index ((x * r + y) * r + z for r regions per axis)
+    bool fine;                  // False for the coarse preview, true for the full-resolution mesh
+    std::vector<float> vertices; // Same layout as marching_cubes()
+    std::vector<float> normals;  // Same layout as compute_normals()
+};
+
+class ProgressiveMesher {
+public:
+    // Constructor
+    // Parameters:
+    // - f, isovalue, min, max, stepsize: Same as marching_cubes(); stepsize is the final resolution.
+    // - regionsPerAxis: The domain is split into regionsPerAxis^3 regions.
+    // - coarseFactor: The preview is extracted with a step of stepsize * coarseFactor.
+    ProgressiveMesher(std::function<float(float, float, float)> f, float isovalue,
+                      float min, float max, float stepsize,
+                      int regionsPerAxis = 4, int coarseFactor = 8);
+
+    // Stops the workers (waiting for the regions in flight) and joins them.
+    ~ProgressiveMesher();
+
+    ProgressiveMesher(const ProgressiveMesher&) = delete;
+    ProgressiveMesher& operator=(const ProgressiveMesher&) = delete;
+
+    // Extracts the coarse preview of every region synchronously, then starts refining in the background.
+    // Parameters:
+    // - eye: Camera position; regions are refined in order of increasing distance from it.
+    // - numThreads: Number of worker threads (0 = hardware concurrency).
+    void start(const glm::vec3& eye, int numThreads = 0);
+
+    // Sets a function the workers call after each region they complete, e.g. to wake a render loop
+    // that blocks waiting for events. It runs on a worker thread. Call before start().
+    void setCompletionCallback(std::function<void()> callback) { onCompleted = std::move(callback); }
+
+    // Moves the meshes completed since the last call into out (render thread).
+    // Returns: True if at least one mesh was added.
+    bool poll(std::vector<RegionMesh>& out);
+
+    // Returns true once every region has its full-resolution mesh and all of them were polled.
+    bool finished();
+
+    // Returns the number of regions.
+    int regionCount() const { return regionsPerAxis * regionsPerAxis * regionsPerAxis; }
+
+private:
+    RegionMesh extractRegion(int region, int factor) const;
+    void worker();
+
+    std::function<float(float, float, float)> f;
+    float isovalue, min, stepsize;
+    int regionsPerAxis, coarseFactor;
+    Lattice lattice;                 // The full lattice; regions are blocks of its cells
+    int cellsPerRegion;              // Cells along each axis of a region
+    float regionSize;                // Edge length of a region
+
+    std::vector<int> order;          // Regions sorted front-to-back
+    std::atomic<int> next{0};        // Next entry of order to refine
+    std::atomic<bool> stopping{false};
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;                // Guards completed and remaining
+    std::vector<RegionMesh> completed;
+    std::function<void()> onCompleted; // Called by a worker after each completed region
+    int remaining = 0;               // Fine regions not yet polled
+};
+
+#endif // PROGRESSIVE_MARCHING_HPP
@@ -0,0 +1,98 @@
+#version 330 core
+
+// field(vec3) is inserted after the #version line by startShaders() in main.cpp (see field.glsl)
+
+in vec2 ndc;
+
+out vec4 FragColor;
+
+uniform mat4 invViewProjection; // Inverse of projection * view
+uniform mat4 viewProjection;    // projection * view, for writing depth
+uniform vec3 boundsMin;         // Domain of the field (same as the mesh extraction)
+uniform vec3 boundsMax;
+uniform float isovalue;         // Isovalue to trace
+uniform float lipschitz;        // Upper bound of |grad field|, makes |f - iso| / lipschitz a safe step
+uniform float minStep;          // Smallest step, so flat regions do not stall the march
+uniform int maxSteps;
+
+uniform vec3 lightDir = normalize(vec3(-1.0, -1.0, -1.0));
+uniform vec3 viewPos = vec3(0.0, 0.0, 5.0);
+uniform vec3 objectColor = vec3(0.2, 0.6, 1.0);
+
+// Central-difference gradient; points toward increasing field values like the mesh normals
+vec3 gradient(vec3 p) {
+    const float h = 1e-3;
+    return vec3(
+        field(p + vec3(h, 0, 0)) - field(p - vec3(h, 0, 0)),
+        field(p + vec3(0, h, 0)) - field(p - vec3(0, h, 0)),
+        field(p + vec3(0, 0, h)) - field(p - vec3(0, 0, h)));
+}
+
+void main() {
+    // Ray from the near plane to the far plane through this pixel
+    vec4 nearPoint = invViewProjection * vec4(ndc, -1.0, 1.0);
+    vec4 farPoint = invViewProjection * vec4(ndc, 1.0, 1.0);
+    vec3 origin = nearPoint.xyz / nearPoint.w;
+    vec3 dir = normalize(farPoint.xyz / farPoint.w - origin);
+
+    // Clip the ray against the field bounds (slab test)
+    vec3 invDir = 1.0 / dir;
+    vec3 t0 = (boundsMin - origin) * invDir;
+    vec3 t1 = (boundsMax - origin) * invDir;
+    vec3 tSmall = min(t0, t1);
+    vec3 tLarge = max(t0, t1);
+    float tNear = max(max(max(tSmall.x, tSmall.y), tSmall.z), 0.0);
+    float tFar = min(min(tLarge.x, tLarge.y), tLarge.z);
+    if (tNear >= tFar) discard;
+
+    // Sphere trace until the sign of field - isovalue changes
+    float t = tNear;
+    float prev = field(origin + dir * t) - isovalue;
+    bool hit = false;
+    float tPrev = t;
+    for (int i = 0; i < maxSteps && t < tFar; ++i) {
+        tPrev = t;
+        t += max(abs(prev) / lipschitz, minStep);
+        float cur = field(origin + dir * min(t, tFar)) - isovalue;
+        if (sign(cur) != sign(prev)) {
+            hit = true;
+            break;
+        }
+        prev = cur;
+    }
+    if (!hit) discard;
+
+    // Refine the crossing by bisection
+    float a = tPrev;
+    float b = min(t, tFar);
+    for (int i = 0; i < 8; ++i) {
+        float m = 0.5 * (a + b);
+        float fm = field(origin + dir * m) - isovalue;
+        if (sign(fm) == sign(prev)) a = m; else b = m;
+    }
+    vec3 FragPos = origin + dir * (0.5 * (a + b));
+
+    vec4 clip = viewProjection * vec4(FragPos, 1.0);
+    gl_FragDepth = 0.5 * (clip.z / clip.w) + 0.5;
+
+    // Same Phong model as fragment_shader.glsl
+
+    // Ambient
+    float ambientStrength = 0.2;
+    vec3 ambient = ambientStrength * objectColor;
+
+    // Diffuse
+    vec3 norm = normalize(gradient(FragPos));
+    float diff = max(dot(norm, -lightDir), 0.0);
+    vec3 diffuse = diff * objectColor;
+
+    // Specular
+    float specularStrength = 0.3;
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * vec3(1.0);
+
+    vec3 result = ambient + diffuse + specular;
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+// Full-screen triangle generated from gl_VertexID (no vertex buffer needed)
+out vec2 ndc;
+
+void main() {
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    ndc = p;
+    gl_Position = vec4(p, 0.0, 1.0);
+}
@@ -0,0 +1,113 @@
+// surface_stats.cpp
+// This file implements the reduction-only extraction declared in surface_stats.hpp.
+
+#include "surface_stats.hpp"
+#include "marching_kernel.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+
+// Running sums of one thread
+struct StatsAccumulator {
+    size_t triangles = 0;
+    double area = 0.0;
+    double volume = 0.0; // Six times the signed volume
+    glm::vec3 lo = glm::vec3(FLT_MAX), hi = glm::vec3(-FLT_MAX);
+
+    void add(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        glm::dvec3 da(a), db(b), dc(c);
+        glm::dvec3 cross = glm::cross(db - da, dc - da);
+        area += 0.5 * glm::length(cross);
+        // Signed volume of the tetrahedron (origin, a, b, c)
+        volume += glm::dot(da, glm::cross(db, dc));
+        lo = glm::min(lo, glm::min(a, glm::min(b, c)));
+        hi = glm::max(hi, glm::max(a, glm::max(b, c)));
+        ++triangles;
+    }
+
+    void merge(const StatsAccumulator& other) {
+        triangles += other.triangles;
+        area += other.area;
+        volume += other.volume;
+        lo = glm::min(lo, other.lo);
+        hi = glm::max(hi, other.hi);
+    }
+
+    SurfaceStats result() const {
+        SurfaceStats stats;
+        stats.triangles = triangles;
+        stats.area = area;
+        // The triangle table winds triangles counter-clockwise as seen from the f > isovalue side,
+        // so the sum is positive for the region where f < isovalue
+        stats.volume = volume / 6.0;
+        if (triangles > 0) {
+            stats.boundsMin = lo;
+            stats.boundsMax = hi;
+        }
+        return stats;
+    }
+};
+
+// Measures the isosurface, accumulating per-thread partial sums in the cell kernel
+SurfaceStats surface_stats(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    const Lattice& lattice,
+    int numThreads
+) {
+    if (numThreads <= 0)
+        numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    numThreads = std::min(numThreads, lattice.cells.x);
+
+    std::vector<StatsAccumulator> partial(numThreads);
+    const int nz = lattice.cells.z + 1;
+    auto worker = [&](int index) {
+        int xBegin = static_cast<int>(static_cast<long long>(lattice.cells.x) * index / numThreads);
+        int xEnd = static_cast<int>(static_cast<long long>(lattice.cells.x) * (index + 1) / numThreads);
+        MarchingWorkspace workspace;
+        StatsAccumulator sums; // Local, stored once: neighbouring slots of partial share cache lines
+        march_lattice(lattice, f, isovalue, workspace, xBegin, xEnd,
+                      [&](int, int y, int z, int cubeIndex, const glm::vec3* pos, const float* val) {
+                          for_each_cached_triangle(workspace, y, z, cubeIndex, pos, val, isovalue, nz,
+                                                   [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+                                                       sums.add(a, b, c);
+                                                   });
+                      });
+        partial[index] = sums;
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    StatsAccumulator total;
+    for (const StatsAccumulator& sums : partial)
+        total.merge(sums);
+    return total.result();
+}
+
+// Measures the isosurface over [min, max] in every axis
+SurfaceStats surface_stats(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    float min,
+    float max,
+    float stepsize,
+    int numThreads
+) {
+    return surface_stats(f, isovalue, make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(stepsize)), numThreads);
+}
+
+// Measures an existing mesh with the same formulas
+SurfaceStats mesh_stats(const std::vector<float>& vertices) {
+    StatsAccumulator sums;
+    for (size_t i = 0; i + 9 <= vertices.size(); i += 9) {
+        sums.add(glm::vec3(vertices[i],     vertices[i + 1], vertices[i + 2]),
+                 glm::vec3(vertices[i + 3], vertices[i + 4], vertices[i + 5]),
+                 glm::vec3(vertices[i + 6], vertices[i + 7], vertices[i + 8]));
+    }
+    return sums.result();
+}
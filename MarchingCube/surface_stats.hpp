@@ -0,0 +1,56 @@
+// surface_stats.hpp
+// This header declares reduction-only extraction: the area, enclosed volume and bounding box of an
+// isosurface are accumulated directly in the cell kernel, without ever storing a triangle.
+
+#ifndef SURFACE_STATS_HPP
+#define SURFACE_STATS_HPP
+
+#include "marching.hpp"
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Measurements of an extracted isosurface.
+struct SurfaceStats {
+    size_t triangles = 0;
+    double area = 0.0;     // Total triangle area
+    double volume = 0.0;   // Volume of the region where f < isovalue (divergence theorem over the
+                           // triangles); only meaningful when the surface is closed inside the lattice
+    glm::vec3 boundsMin = glm::vec3(0.0f); // Bounding box of the vertices (zero when there are none)
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// Measures the isosurface of a scalar field without building the mesh.
+// Each thread sweeps a range of x-slabs into its own partial sums, which are combined at the end.
+// Parameters:
+// - f: Scalar field; it is called concurrently from all threads, so it must be thread-safe.
+// - isovalue: The isosurface value.
+// - lattice: The sampling lattice.
+// - numThreads: Number of threads (0 = hardware concurrency).
+// Returns: The measurements; they equal mesh_stats(marching_cubes(f, isovalue, lattice))
+// up to floating-point summation order.
+SurfaceStats surface_stats(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    const Lattice& lattice,
+    int numThreads = 0
+);
+
+// Same as above over [min, max] in every axis.
+SurfaceStats surface_stats(
+    const std::function<float(float, float, float)>& f,
+    float isovalue,
+    float min,
+    float max,
+    float stepsize,
+    int numThreads = 0
+);
+
+// Measures an existing mesh.
+// Parameters:
+// - vertices: A vector of vertices in the layout of marching_cubes().
+// Returns: The measurements.
+SurfaceStats mesh_stats(const std::vector<float>& vertices);
+
+#endif // SURFACE_STATS_HPP
@@ -0,0 +1,232 @@
+// temporal.cpp
+// This file implements the temporally coherent Marching Cubes extractor declared in temporal.hpp.
+
+#include "temporal.hpp"
+#include "marching.hpp"
+#include "memory.hpp"
+#include "TriTable.hpp" // Cube corner ordering
+#include <cmath>
+#include <algorithm>
+
+// Constructor: sets up the lattice covering [min, max) in every axis.
+TemporalMarchingCubes::TemporalMarchingCubes(float min, float max, float stepsize,
+                                             float epsilon, int keyframeInterval)
+    : min(min), stepsize(stepsize), epsilon(epsilon), keyframeInterval(keyframeInterval) {
+    // Number of cells per axis, from the same rounding as marching_cubes()
+    n = make_lattice(glm::vec3(min), glm::vec3(max), glm::vec3(stepsize)).cells.x;
+    reset();
+}
+
+// Forgets all cached state; the next update() is a full extraction.
+void TemporalMarchingCubes::reset() {
+    size_t numSamples = static_cast<size_t>(n + 1) * (n + 1) * (n + 1);
+    size_t numCells = static_cast<size_t>(n) * n * n;
+    values.assign(numSamples, 0.0f);
+    reference.assign(numSamples, 0.0f);
+    sampledFrame.assign(numSamples, -1);
+    dirtyFrame.assign(numCells, -1);
+    dirtyCells.clear();
+    cellSlot.assign(numCells, -1);
+    slotVertices.clear();
+    slotSize.clear();
+    freeSlots.clear();
+    activeCells.clear();
+    activated.clear();
+    deactivated = false;
+    flattened.clear();
+    flattenedValid = false;
+    frame = 0;
+}
+
+// Evaluates the field at a lattice point (at most once per frame) and marks the cells that
+// share the point when its value moved by more than epsilon since their last triangulation.
+void TemporalMarchingCubes::sample(const std::function<float(float, float, float)>& f, int x, int y, int z) {
+    int idx = sampleIndex(x, y, z);
+    if (sampledFrame[idx] == frame) return;
+    sampledFrame[idx] = frame;
+
+    float v = f(min + x * stepsize, min + y * stepsize, min + z * stepsize);
+    values[idx] = v;
+    ++delta.samplesEvaluated;
+
+    if (std::fabs(v - reference[idx]) > epsilon) {
+        reference[idx] = v;
+        markCellsAround(x, y, z);
+    }
+}
+
+// Evaluates the field at a lattice point (at most once per frame) without marking any cell or moving
+// its reference, so a change beyond epsilon is still detected when the point is next sampled.
+void TemporalMarchingCubes::refresh(const std::function<float(float, float, float)>& f, int x, int y, int z) {
+    int idx = sampleIndex(x, y, z);
+    if (sampledFrame[idx] == frame) return;
+    sampledFrame[idx] = frame;
+    values[idx] = f(min + x * stepsize, min + y * stepsize, min + z * stepsize);
+    ++delta.samplesEvaluated;
+}
+
+// Marks the (up to 8) cells sharing lattice point (x, y, z) for re-triangulation.
+void TemporalMarchingCubes::markCellsAround(int x, int y, int z) {
+    for (int cx = x - 1; cx <= x; ++cx) {
+        if (cx < 0 || cx >= n) continue;
+        for (int cy = y - 1; cy <= y; ++cy) {
+            if (cy < 0 || cy >= n) continue;
+            for (int cz = z - 1; cz <= z; ++cz) {
+                if (cz < 0 || cz >= n) continue;
+                int cell = cellIndex(cx, cy, cz);
+                if (dirtyFrame[cell] == frame) continue;
+                dirtyFrame[cell] = frame;
+                dirtyCells.push_back(cell);
+            }
+        }
+    }
+}
+
+// Returns a free slot, growing the slot arrays if none was released.
+int TemporalMarchingCubes::allocateSlot() {
+    if (!freeSlots.empty()) {
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    slotSize.push_back(0);
+    slotVertices.resize(slotVertices.size() + SlotFloats);
+    return static_cast<int>(slotSize.size()) - 1;
+}
+
+// Re-triangulates one cell from the cached lattice values and records a patch if it changed.
+void TemporalMarchingCubes::triangulate(int cell, float isovalue) {
+    int x = cell / (n * n);
+    int y = (cell / n) % n;
+    int z = cell % n;
+
+    float val[8];
+    int below = 0;
+    for (int i = 0; i < 8; ++i) {
+        val[i] = values[sampleIndex(x + marching_cubes_corners[i][0], y + marching_cubes_corners[i][1],
+                                    z + marching_cubes_corners[i][2])];
+        below += val[i] < isovalue;
+    }
+    ++delta.cellsExamined;
+
+    int slot = cellSlot[cell];
+    if (slot < 0 && (below == 0 || below == 8)) return; // Still inactive, most dirty cells
+
+    glm::vec3 pos[8];
+    for (int i = 0; i < 8; ++i)
+        pos[i] = glm::vec3(min + (x + marching_cubes_corners[i][0]) * stepsize,
+                           min + (y + marching_cubes_corners[i][1]) * stepsize,
+                           min + (z + marching_cubes_corners[i][2]) * stepsize);
+    scratch.clear();
+    polygonise_cube(pos, val, isovalue, scratch);
+
+    if (scratch.empty()) {
+        if (slot < 0) return; // Still inactive
+        freeSlots.push_back(slot);
+        cellSlot[cell] = -1;
+        deactivated = true;
+    } else {
+        if (slot < 0) {
+            slot = allocateSlot();
+            cellSlot[cell] = slot;
+            activated.push_back(cell);
+        } else if (slotSize[slot] == scratch.size() &&
+                   std::equal(scratch.begin(), scratch.end(), slotVertices.begin() + slot * SlotFloats)) {
+            return; // Unchanged
+        }
+        std::copy(scratch.begin(), scratch.end(), slotVertices.begin() + slot * SlotFloats);
+        slotSize[slot] = static_cast<unsigned char>(scratch.size());
+    }
+
+    delta.patches.push_back({cell, static_cast<int>(delta.vertices.size()), static_cast<int>(scratch.size())});
+    delta.vertices.insert(delta.vertices.end(), scratch.begin(), scratch.end());
+    flattenedValid = false;
+}
+
+// Advances to the next frame and returns the cells whose triangles changed.
+const MeshDelta& TemporalMarchingCubes::update(const std::function<float(float, float, float)>& f, float isovalue) {
+    MemoryScope scope(MEM_MESHING);
+    delta.patches.clear(); // Keeps the capacity of the previous frames
+    delta.vertices.clear();
+    delta.cellsExamined = delta.samplesEvaluated = 0;
+    dirtyCells.clear();
+
+    bool restart = (frame == 0) || (isovalue != lastIsovalue);
+    delta.keyframe = restart || keyframeInterval <= 1 || (frame % keyframeInterval) == 0;
+    lastIsovalue = isovalue;
+
+    if (delta.keyframe) {
+        // Sample the whole lattice
+        for (int x = 0; x <= n; ++x)
+            for (int y = 0; y <= n; ++y)
+                for (int z = 0; z <= n; ++z)
+                    sample(f, x, y, z);
+    } else {
+        // Sample only the band of active cells and their 26 neighbours, i.e. the 4x4x4 lattice
+        // points around every active cell
+        for (int cell : activeCells) {
+            int x = cell / (n * n);
+            int y = (cell / n) % n;
+            int z = cell % n;
+            for (int px = std::max(x - 1, 0); px <= std::min(x + 2, n); ++px)
+                for (int py = std::max(y - 1, 0); py <= std::min(y + 2, n); ++py)
+                    for (int pz = std::max(z - 1, 0); pz <= std::min(z + 2, n); ++pz)
+                        sample(f, px, py, pz);
+        }
+    }
+
+    if (restart) {
+        // Every cell has to be classified against the (new) isovalue
+        reference = values;
+        dirtyCells.clear();
+        for (int cell = 0; cell < n * n * n; ++cell) {
+            dirtyFrame[cell] = frame;
+            dirtyCells.push_back(cell);
+        }
+    }
+
+    // A point on the outer edge of the band also marks cells outside it, whose other corners were last
+    // sampled at an earlier frame. Bring those corners up to date so that no cell mixes old and new
+    // samples. Refreshing does not mark further cells, so the band does not grow from frame to frame.
+    for (int cell : dirtyCells) {
+        int x = cell / (n * n);
+        int y = (cell / n) % n;
+        int z = cell % n;
+        for (int i = 0; i < 8; ++i)
+            refresh(f, x + marching_cubes_corners[i][0], y + marching_cubes_corners[i][1], z + marching_cubes_corners[i][2]);
+    }
+
+    for (int cell : dirtyCells)
+        triangulate(cell, isovalue);
+
+    // Keep activeCells sorted: drop the cells that left the surface, merge in the new ones
+    if (deactivated) {
+        activeCells.erase(std::remove_if(activeCells.begin(), activeCells.end(),
+                                         [this](int cell) { return cellSlot[cell] < 0; }),
+                          activeCells.end());
+        deactivated = false;
+    }
+    if (!activated.empty()) {
+        std::sort(activated.begin(), activated.end());
+        size_t middle = activeCells.size();
+        activeCells.insert(activeCells.end(), activated.begin(), activated.end());
+        std::inplace_merge(activeCells.begin(), activeCells.begin() + middle, activeCells.end());
+        activated.clear();
+    }
+
+    ++frame;
+    return delta;
+}
+
+// Returns the patched mesh, copying the slots of the active cells in cell order when they changed.
+const std::vector<float>& TemporalMarchingCubes::mesh() {
+    if (!flattenedValid) {
+        flattened.clear();
+        for (int cell : activeCells) {
+            auto first = slotVertices.begin() + cellSlot[cell] * SlotFloats;
+            flattened.insert(flattened.end(), first, first + slotSize[cellSlot[cell]]);
+        }
+        flattenedValid = true;
+    }
+    return flattened;
+}
@@ -0,0 +1,103 @@
+// temporal.hpp
+// This header declares a temporally coherent Marching Cubes extractor for time-series volumes.
+// Consecutive frames of a slowly evolving field differ only slightly, so instead of re-running
+// marching_cubes() on every frame the extractor keeps the previous frame's active cells and only
+// re-triangulates cells whose corner values changed by more than an epsilon.
+
+#ifndef TEMPORAL_MARCHING_HPP
+#define TEMPORAL_MARCHING_HPP
+
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+
+// The triangles of a single lattice cell after an update, as a range of MeshDelta::vertices.
+// An empty range means the cell no longer intersects the surface.
+struct CellPatch {
+    int cell;  // Linear cell index ((x * n + y) * n + z)
+    int first; // Index of the first float of the cell's new triangles (xyz triples)
+    int count; // Number of floats
+};
+
+// The changes between two consecutive frames.
+struct MeshDelta {
+    std::vector<CellPatch> patches; // One entry per re-triangulated cell whose triangles changed
+    std::vector<float> vertices;    // New triangles of all patches, back to back
+    int cellsExamined = 0;          // Number of cells that were re-triangulated this frame
+    int samplesEvaluated = 0;       // Number of field evaluations performed this frame
+    bool keyframe = false;          // True when the whole lattice was sampled
+};
+
+// Extracts isosurfaces from a sequence of scalar fields sampled on a fixed lattice.
+// Every field value is evaluated once per lattice point (instead of once per cube corner), and
+// only cells touching a point that moved by more than epsilon are re-triangulated.
+// Between keyframes only the band of previously active cells and their neighbours is sampled;
+// a keyframe samples the whole lattice so surfaces appearing away from the band are picked up.
+class TemporalMarchingCubes {
+public:
+    // Constructor
+    // Parameters:
+    // - min, max: The bounds of the scalar field (same meaning as in marching_cubes()).
+    // - stepsize: The step size for sampling the scalar field.
+    // - epsilon: Corner values that change by less than this are considered unchanged.
+    // - keyframeInterval: Sample the whole lattice every N frames (1 = every frame).
+    TemporalMarchingCubes(float min, float max, float stepsize,
+                          float epsilon = 1e-4f, int keyframeInterval = 16);
+
+    // Advances to the next frame.
+    // Parameters:
+    // - f: The scalar field for this frame.
+    // - isovalue: The isosurface value to extract. Changing it forces a full re-extraction.
+    // Returns: The cells whose triangles changed since the previous frame.
+    const MeshDelta& update(const std::function<float(float, float, float)>& f, float isovalue);
+
+    // Returns the patched mesh for the current frame, in the same vertex layout as marching_cubes().
+    // The flattened vector is rebuilt lazily, only when a frame changed some cell.
+    const std::vector<float>& mesh();
+
+    // Returns the number of cells currently intersecting the surface.
+    size_t activeCellCount() const { return activeCells.size(); }
+
+    // Forgets all cached state; the next update() is a full extraction.
+    void reset();
+
+private:
+    int sampleIndex(int x, int y, int z) const { return (x * (n + 1) + y) * (n + 1) + z; }
+    int cellIndex(int x, int y, int z) const { return (x * n + y) * n + z; }
+    void sample(const std::function<float(float, float, float)>& f, int x, int y, int z);
+    void refresh(const std::function<float(float, float, float)>& f, int x, int y, int z);
+    void markCellsAround(int x, int y, int z);
+    void triangulate(int cell, float isovalue);
+    int allocateSlot();
+
+    float min, stepsize, epsilon;
+    int n;                 // Number of cells along each axis
+    int keyframeInterval;
+    int frame = 0;
+    float lastIsovalue = 0.0f;
+
+    std::vector<float> values;      // Latest known value of every lattice point
+    std::vector<float> reference;   // Value of every lattice point at its last re-triangulation
+    std::vector<int> sampledFrame;  // Frame in which each lattice point was last evaluated
+    std::vector<int> dirtyFrame;    // Frame in which each cell was last marked for re-triangulation
+    std::vector<int> dirtyCells;    // Cells to re-triangulate this frame
+
+    // Triangles of the active cells, in fixed-size slots of one flat array, so re-triangulating a
+    // cell never allocates
+    static constexpr int SlotFloats = 45;   // 5 triangles of 3 xyz vertices, the most a cell has
+    std::vector<int> cellSlot;              // Slot of every cell, -1 for cells off the surface
+    std::vector<float> slotVertices;        // SlotFloats floats per slot
+    std::vector<unsigned char> slotSize;    // Floats used in every slot
+    std::vector<int> freeSlots;             // Slots released by cells that left the surface
+    std::vector<int> activeCells;           // Cells with a slot, in increasing order
+    std::vector<int> activated;             // Cells that got a slot this frame, merged in at the end
+    bool deactivated = false;               // Some cell lost its slot this frame
+    std::vector<float> scratch;             // Triangles of the cell being re-triangulated
+
+    std::vector<float> flattened;   // Triangles of activeCells, in cell order
+    bool flattenedValid = false;
+
+    MeshDelta delta;
+};
+
+#endif // TEMPORAL_MARCHING_HPP
@@ -0,0 +1,57 @@
+// alloc_test.cpp
+// This file checks that ExtractionContext performs no heap allocations once it has warmed up: it
+// replaces operator new with a counter and remeshes a slowly changing field for a number of frames,
+// with one and with three threads, then checks that the output still matches marching_cubes().
+//
+// memory.cpp replaces operator new as well, so build it with memory tracking off. From the
+// MarchingCube directory:
+//     g++ -std=c++20 -O2 -DMEMORY_TRACKING=0 -I. tests/alloc_test.cpp extraction.cpp marching.cpp log.cpp memory.cpp metrics.cpp -o alloc_test -pthread
+//     ./alloc_test
+
+#include "extraction.hpp"
+#include "marching.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<long> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    const int frames = 20, warmup = 2;
+    float t = 0.0f;
+    std::function<float(float, float, float)> f = [&t](float x, float y, float z) {
+        return x * x + y * y + z * z - 0.3f * std::sin(4.0f * x + t) * std::cos(3.0f * y);
+    };
+
+    int failures = 0;
+    for (int threads : {1, 3}) {
+        ExtractionContext context(threads);
+        long steady = 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            t = 0.01f * (frame % 2); // Two nearly identical fields, as in an animation
+            long before = allocations.load();
+            context.extract(f, 1.0f, -2.0f, 2.0f, 0.04f);
+            context.computeNormals();
+            if (frame >= warmup) steady += allocations.load() - before;
+        }
+
+        t = 0.0f;
+        std::vector<float> expected = marching_cubes(f, 1.0f, -2.0f, 2.0f, 0.04f);
+        bool same = context.extract(f, 1.0f, -2.0f, 2.0f, 0.04f) == expected;
+        std::printf("%d threads: %ld allocations over %d frames after warm-up, output %s marching_cubes()\n",
+                    threads, steady, frames - warmup, same ? "matches" : "differs from");
+        if (steady != 0 || !same) ++failures;
+    }
+    return failures == 0 ? 0 : 1;
+}
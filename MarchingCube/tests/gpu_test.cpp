@@ -0,0 +1,75 @@
+// gpu_test.cpp
+// This file checks the compute-shader engine against marching_cubes(): for a few step sizes the
+// compacted triangle count must be equal, and the vertices read back from the GPU must match the
+// CPU mesh triangle for triangle (both emit cells in the same order). It opens an invisible window
+// for an OpenGL 4.3 context, so it runs on any driver with compute shaders, llvmpipe included.
+//
+// Build and run from the MarchingCube directory (field.glsl is read from there):
+//     g++ -std=c++20 -O2 -I. tests/gpu_test.cpp gpu_marching.cpp marching.cpp log.cpp memory.cpp metrics.cpp -o gpu_test -lGL -lglfw -lGLEW -pthread
+//     LIBGL_ALWAYS_SOFTWARE=1 ./gpu_test
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "gpu_marching.hpp"
+#include "marching.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+int main() {
+    if (!glfwInit()) {
+        std::printf("Failed to initialize GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "gpu_test", nullptr, nullptr);
+    if (!window) {
+        std::printf("Failed to create an OpenGL 4.3 context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::printf("Failed to initialize GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    // Must match field.glsl
+    auto f = [](float x, float y, float z) { return std::cos(x * 2) - std::sin(y * 2) - std::sin(z * 2); };
+    const float min = -5.0f, max = 5.0f, isovalue = -1.5f;
+
+    int failures = 0;
+    {
+        GpuMarchingCubes gpu("field.glsl", 1 << 21);
+        for (float step : {0.25f, 0.2f, 0.1f}) {
+            gpu.extract(isovalue, min, max, step);
+            std::vector<float> expected = marching_cubes(f, isovalue, min, max, step);
+            size_t triangles = gpu.readTriangleCount();
+
+            // GPU and CPU sin/cos differ in the last bits, so positions match to a tolerance only
+            std::vector<float> vertices, normals;
+            gpu.readMesh(vertices, normals);
+            float maxDiff = 0.0f;
+            bool finite = true;
+            for (size_t i = 0; i < std::min(vertices.size(), expected.size()); ++i) {
+                maxDiff = std::max(maxDiff, std::fabs(vertices[i] - expected[i]));
+                finite = finite && std::isfinite(vertices[i]);
+            }
+            bool same = triangles == expected.size() / 9 && vertices.size() == expected.size() && finite &&
+                        maxDiff < 1e-4f && !gpu.truncated() && glGetError() == GL_NO_ERROR;
+            std::printf("step %g: %zu GPU triangles, %zu CPU triangles, largest vertex difference %g: %s\n", step,
+                        triangles, expected.size() / 9, maxDiff, same ? "ok" : "FAILED");
+            if (!same) ++failures;
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// temporal_test.cpp
+// This file checks that TemporalMarchingCubes produces the same mesh as a full marching_cubes() run on
+// frames between keyframes, when only the band around the previous surface is sampled, and times the
+// updates of those frames against the full runs.
+//
+// Build and run from the MarchingCube directory:
+//     g++ -std=c++20 -O2 -I. tests/temporal_test.cpp temporal.cpp marching.cpp log.cpp memory.cpp metrics.cpp -o temporal_test -pthread
+//     ./temporal_test
+
+#include "temporal.hpp"
+#include "marching.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+// Runs 15 frames of a time-varying field through both extractors.
+// Parameters:
+// - name: Printed with the results.
+// - field: Returns the field of a frame.
+// Returns: The number of frames between keyframes whose meshes differ.
+static int run(const char* name, const std::function<std::function<float(float, float, float)>(int)>& field) {
+    const float min = -5.0f, max = 5.0f, step = 0.1f, isovalue = -1.5f;
+    // Epsilon 0: any change re-triangulates, so the meshes must be equal to the last bit
+    TemporalMarchingCubes extractor(min, max, step, 0.0f, 16);
+
+    using Clock = std::chrono::steady_clock;
+    std::chrono::duration<double, std::milli> temporalTime{0}, fullTime{0};
+    int failures = 0, checked = 0;
+    for (int frame = 0; frame < 15; ++frame) {
+        auto f = field(frame);
+        auto start = Clock::now();
+        if (extractor.update(f, isovalue).keyframe) continue;
+        const std::vector<float>& mesh = extractor.mesh();
+        auto middle = Clock::now();
+        std::vector<float> expected = marching_cubes(f, isovalue, min, max, step);
+        temporalTime += middle - start;
+        fullTime += Clock::now() - middle;
+        ++checked;
+        if (mesh != expected) {
+            std::printf("%s, frame %d: %zu temporal vertices, %zu expected\n", name, frame, mesh.size() / 3,
+                        expected.size() / 3);
+            ++failures;
+        }
+    }
+    std::printf("%s: %d of %d frames between keyframes differ from marching_cubes()\n", name, failures, checked);
+    if (checked > 0)
+        std::printf("%s: %.2f ms per temporal update, %.2f ms per marching_cubes() (%.1fx)\n", name,
+                    temporalTime.count() / checked, fullTime.count() / checked, fullTime / temporalTime);
+    return checked > 0 ? failures : 1;
+}
+
+int main() {
+    int failures = 0;
+
+    // The viewer's floating balls, drifting by about a cell per frame: every lattice point changes,
+    // and cells marked from the edge of the band have corners that were sampled frames ago
+    failures += run("drifting", [](int frame) {
+        float t = 0.25f * frame;
+        return [t](float x, float y, float z) {
+            return std::cos(x * 2 + t) - std::sin(y * 2) - std::sin(z * 2 + 0.5f * t);
+        };
+    });
+
+    // A slowly evolving volume: two metaballs at rest and a third moving by a fifth of a cell per frame
+    failures += run("slow", [](int frame) {
+        float t = 0.02f * frame;
+        return [t](float x, float y, float z) {
+            auto ball = [&](float cx, float cy, float cz) {
+                return 1.0f / ((x - cx) * (x - cx) + (y - cy) * (y - cy) + (z - cz) * (z - cz) + 0.01f);
+            };
+            return -(ball(-2.0f, 0.0f, 0.0f) + ball(2.0f, 1.0f, 0.0f) + ball(0.0f, -1.0f + t, 1.5f));
+        };
+    });
+
+    return failures == 0 ? 0 : 1;
+}
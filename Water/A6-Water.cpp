@@ -1,7 +1,9 @@
 // Include standard headers
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cmath>
+#include <algorithm>
 
 #include <GL/glew.h>
 
@@ -20,6 +22,58 @@ using namespace glm;
 #include <vector>
 
 #include "PlaneMesh.hpp"
+#include "gl_loader.hpp"
+#include "task_graph.hpp"
+#include "asset_pack.hpp"
+#include "dynamic_resolution.hpp"
+#include "detail_tuner.hpp"
+#include "sweep.hpp"
+#include "log.hpp"
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Sweep mode: water --sweep <grid file> [output.csv]
+// Renders every configuration of the grid into an offscreen target of an invisible window
+//////////////////////////////////////////////////////////////////////////////
+
+int sweepMain(int argc, char* argv[])
+{
+	if (argc < 3) {
+		LOG_ERROR("Usage: {} --sweep <grid file> [output.csv]", argv[0]);
+		return -1;
+	}
+	const char* csvPath = argc > 3 ? argv[3] : "sweep.csv";
+	SweepGrid grid;
+	if (!readSweepGrid(argv[2], grid))
+		return -1;
+
+	if( !glfwInit() )
+	{
+		LOG_ERROR("Failed to initialize GLFW");
+		return -1;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_SAMPLES, 0); // The offscreen target carries the multisampling
+	window = glfwCreateWindow(64, 64, "Water sweep", NULL, NULL);
+	if( window == NULL ){
+		LOG_ERROR("Failed to create a hidden GLFW window");
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glewExperimental = true; // Needed for core profile
+	if (glewInit() != GLEW_OK) {
+		LOG_ERROR("Failed to initialize GLEW");
+		glfwTerminate();
+		return -1;
+	}
+
+	bool ok = runSweep(grid, csvPath);
+	if (ok)
+		LOG_INFO("Wrote {} configurations to {}", grid.configs().size(), csvPath);
+	glfwTerminate();
+	return ok ? 0 : -1;
+}
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -28,6 +82,8 @@ using namespace glm;
 
 int main( int argc, char* argv[])
 {
+	if (argc > 1 && strcmp(argv[1], "--sweep") == 0)
+		return sweepMain(argc, argv);
 
 	///////////////////////////////////////////////////////
 	float screenW = 1500;
@@ -36,6 +92,9 @@ int main( int argc, char* argv[])
 
 	float xmin = -10;
 	float xmax = 10;
+	float frameBudgetMs = 12.0f; // GPU time per frame held by dynamic resolution (0 = render at full size)
+	float waterBudgetMs = 8.0f;  // GPU time of the water pass held by the detail tuner (0 = fixed detail)
+	DetailBounds detailBounds;   // Tessellation and wave count limits of the tuner
 
 	if (argc > 1 ) {
 		screenW = atoi(argv[1]);
@@ -52,19 +111,45 @@ int main( int argc, char* argv[])
 	if (argc > 5) {
 		xmax = atof(argv[5]);
 	}
+	if (argc > 6) {
+		frameBudgetMs = atof(argv[6]);
+	}
+	if (argc > 7) {
+		waterBudgetMs = atof(argv[7]);
+	}
+	if (argc > 8) {
+		detailBounds.minTess = atof(argv[8]);
+	}
+	if (argc > 9) {
+		detailBounds.maxTess = atof(argv[9]);
+	}
+	if (argc > 10) {
+		detailBounds.minWaves = atoi(argv[10]);
+	}
+	if (argc > 11) {
+		detailBounds.maxWaves = atoi(argv[11]);
+	}
 
 
 	///////////////////////////////////////////////////////
 
+	// Shaders and textures come from the asset pack if it was built (make water.pak), loose files otherwise
+	AssetPack pack("water.pak");
+
+	// Start generating the plane, reading the shaders and decoding the textures while the window opens
+	TaskGraph startup;
+	PlaneMesh plane(xmin, xmax, stepsize, startup, &pack);
+
 	// Initialise GLFW
 	if( !glfwInit() )
 	{
-		fprintf( stderr, "Failed to initialize GLFW\n" );
+		LOG_ERROR("Failed to initialize GLFW");
 		getchar();
 		return -1;
 	}
 
-	glfwWindowHint(GLFW_SAMPLES, 4);
+	// With dynamic resolution the offscreen target is multisampled instead of the window
+	glfwWindowHint(GLFW_SAMPLES, frameBudgetMs > 0 ? 0 : 4);
 	// glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	// glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	// glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
@@ -73,7 +158,7 @@ int main( int argc, char* argv[])
 	// Open a window and create its OpenGL context
 	window = glfwCreateWindow( screenW, screenH, "Phong", NULL, NULL);
 	if( window == NULL ){
-		fprintf( stderr, "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials.\n" );
+		LOG_ERROR("Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials.");
 		getchar();
 		glfwTerminate();
 		return -1;
@@ -83,14 +168,38 @@ int main( int argc, char* argv[])
 	// Initialize GLEW
 	glewExperimental = true; // Needed for core profile
 	if (glewInit() != GLEW_OK) {
-		fprintf(stderr, "Failed to initialize GLEW\n");
+		LOG_ERROR("Failed to initialize GLEW");
 		getchar();
 		glfwTerminate();
 		return -1;
 	}
+	enableParallelShaderCompile();
+
+	// Offscreen scene target whose size follows the measured GPU time
+	DynamicResolution* resolution = NULL;
+	if (frameBudgetMs > 0) {
+		if (DynamicResolution::supported())
+			resolution = new DynamicResolution(frameBudgetMs);
+		else
+			LOG_WARN("GPU timer queries are not supported; rendering at full resolution");
+	}
+
+	// Tessellation and wave count follow the measured GPU time of the water pass
+	DetailTuner* tuner = NULL;
+	if (waterBudgetMs > 0) {
+		if (DetailTuner::supported()) {
+			detailBounds.maxWaves = std::min(detailBounds.maxWaves, plane.maxWaveCount());
+			tuner = new DetailTuner(waterBudgetMs, detailBounds, plane.tessellation(), plane.waveCount());
+			plane.setTessellation(tuner->tessellation(), tuner->tessellation());
+			plane.setWaveCount(tuner->waveCount());
+		}
+		else
+			LOG_WARN("GPU timer queries are not supported; using fixed water detail");
+	}
 
 
-	PlaneMesh plane(xmin, xmax, stepsize);
+	// Textures and buffers are created on a background context so the first frames do not stall
+	GLLoader* loader = new GLLoader(window);
 	
 	//TextureMesh boat("Assets/boat.ply", "Assets/boat.bmp", 1);
 	//TextureMesh head("Assets/head.ply", "Assets/head.bmp", 1);
@@ -117,12 +226,43 @@ int main( int argc, char* argv[])
 	glDepthFunc(GL_LESS);
 
 	do{
+		// Pick up the resources that finished loading and queue the ones whose CPU work is done
+		loader->poll();
+		plane.update(*loader);
+
+		// Advance the foam before the scene target is bound
+		plane.updateFoam();
+
+		// Draw into the scaled offscreen target
+		if (resolution) {
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+			resolution->beginFrame(width, height);
+		}
+
 		// Clear the screen
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		cameraControlsGlobe(V, 5);
 		
+		// Only time passes that draw the plane: while it is still loading draw() returns at once, and
+		// those near-zero passes would make the tuner jump straight to the maximum detail
+		bool timed = tuner && plane.ready();
+		if (timed)
+			tuner->beginPass();
 		plane.draw(lightpos, V, Projection);
+		if (timed) {
+			tuner->endPass();
+			if (tuner->update()) {
+				plane.setTessellation(tuner->tessellation(), tuner->tessellation());
+				plane.setWaveCount(tuner->waveCount());
+				LOG_DEBUG("Water pass {} ms: tessellation {}, {} waves", tuner->passMs(), tuner->tessellation(), tuner->waveCount());
+			}
+		}
+
+		// Upscale to the window and adapt the scale for the coming frames
+		if (resolution)
+			resolution->endFrame();
 
 		// Swap buffers
 		glfwSwapBuffers(window);
@@ -132,6 +272,15 @@ int main( int argc, char* argv[])
 	while( glfwGetKey(window, GLFW_KEY_ESCAPE ) != GLFW_PRESS &&
 		   glfwWindowShouldClose(window) == 0 );
 
+	// Delete the plane's GL objects (and its foam map) while the context is current; the plane
+	// itself goes out of scope after glfwTerminate, so its destructor must not touch GL
+	plane.release();
+
+	// Stop the loader while its shared context can still be destroyed
+	delete loader;
+	delete resolution;
+	delete tuner;
+
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
 	return 0;
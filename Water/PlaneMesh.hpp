@@ -2,11 +2,20 @@
 
 #include "camera.hpp"
 #include "shader_utils.hpp"
+#include "gl_loader.hpp"
+#include "task_graph.hpp"
+#include "asset_pack.hpp"
+#include "waves.hpp"
+#include "foam_map.hpp"
+#include "log.hpp"
 
 #include <vector>
+#include <algorithm>
+#include <memory>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 
 // Declare if not already
 GLuint loadTextureBMP(const char* filepath); // Function to load BMP textures
@@ -27,6 +36,33 @@ class PlaneMesh {
     GLuint vao, vboVerts, vboNormals, ebo; // Vertex Array Object, Vertex/Normal Buffers, Element Buffer
     GLuint shaderProgram;                  // Shader program ID
     GLuint waterTex, dispTex;              // Texture IDs for water and displacement maps
+    int pendingLoads = 0;                  // Resources still being created by a GLLoader
+
+    // Surface detail
+    std::vector<GerstnerWave> waves = defaultWaves(); // Wave table, most visible first
+    int activeWaves = static_cast<int>(waves.size());  // Number of waves drawn
+    float outerTess = 16.0f, innerTess = 16.0f;        // Tessellation levels of every patch
+    float waveLodPixels = 16.0f;                       // Waves are skipped once a wavelength covers fewer pixels
+    float step = 1.0f;                                 // Size of a patch
+    std::unique_ptr<FoamMap> foam;                     // Created once a context is current
+
+    // A texture loaded by the startup pipeline
+    struct StartupTexture {
+        const char* path = nullptr;
+        const PackEntry* packed = nullptr; // Entry in the asset pack, if it has one
+        TaskGraph::Task task;              // Decodes the BMP, or reads the packed pages in
+        BMPImage image;                    // Decoded loose file, released after upload
+        bool queued = false;
+    };
+
+    // Startup pipeline (see the TaskGraph constructor)
+    const AssetPack* pack = nullptr;
+    TaskGraph::Task geometryTask, shaderTask;  // CPU work running on worker threads
+    ShaderSources shaderSources;               // Filled by shaderTask
+    StartupTexture water, disp;
+    bool buffersQueued = false;
+    bool programLinking = false;           // compileProgram has been issued, not checked yet
+    bool programLinked = true;             // The program can be used
 
     // Function to generate the plane mesh as quads
     void planeMeshQuads(float min, float max, float stepsize) {
@@ -51,12 +87,92 @@ class PlaneMesh {
         }
     }
 
+    // Function to create and fill the vertex, normal and element buffers (any context)
+    void createBuffers() {
+        // Vertex buffer
+        glGenBuffers(1, &vboVerts);
+        glBindBuffer(GL_ARRAY_BUFFER, vboVerts);
+        glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
+
+        // Normal buffer
+        glGenBuffers(1, &vboNormals);
+        glBindBuffer(GL_ARRAY_BUFFER, vboNormals);
+        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
+
+        // Element buffer
+        glGenBuffers(1, &ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    // Function to set up the VAO over the buffers (render context: VAOs are not shared)
+    void createVertexArray() {
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vboVerts);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // Position attribute
+        glEnableVertexAttribArray(0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vboNormals);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // Normal attribute
+        glEnableVertexAttribArray(1);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+        glBindVertexArray(0); // Unbind VAO
+    }
+
+    // Function to start the CPU side of a texture: with a packed copy the pages are read in ahead of
+    // the upload, otherwise the BMP is decoded
+    void startTexture(TaskGraph& startup, StartupTexture& texture, const char* path) {
+        texture.path = path;
+        texture.packed = pack ? pack->find(path) : nullptr;
+        texture.task = startup.add([this, &texture]() {
+            if (texture.packed)
+                pack->data(*texture.packed);
+            else
+                decodeBMP(texture.path, texture.image);
+        });
+    }
+
+    // Function to hand a texture to the loader once its task has finished; the real texture replaces
+    // the placeholder in target when the upload is done. Falls back to the loose file if the context
+    // cannot use the packed format.
+    void queueTexture(GLLoader& loader, StartupTexture& texture, GLuint& target) {
+        if (texture.queued || !TaskGraph::finished(texture.task)) return;
+        texture.queued = true;
+        auto id = std::make_shared<GLuint>(0);
+        loader.submit([this, id, &texture]() {
+                          if (texture.packed) {
+                              *id = pack->uploadTexture(*texture.packed);
+                              if (*id == 0) decodeBMP(texture.path, texture.image); // Format not supported here
+                          }
+                          if (*id == 0 && !texture.image.data.empty())
+                              *id = uploadTextureBMP(texture.image);
+                          texture.image = BMPImage(); // Release the decoded pixels
+                      },
+                      [id, &target]() {
+                          if (*id == 0) {
+                              LOG_WARN("⚠️ Warning: One or more textures failed to load.");
+                              return; // Keep the placeholder
+                          }
+                          glDeleteTextures(1, &target); // The placeholder
+                          target = *id;
+                      });
+    }
+
 public:
-    // Constructor to initialize the plane mesh
+    // Constructor to initialize the plane mesh; everything is loaded here, on the current context
     PlaneMesh(float min, float max, float stepsize) {
         this->min = min;
         this->max = max;
+        this->step = stepsize;
         modelColor = glm::vec4(0, 1.0f, 1.0f, 1.0f); // Default color (cyan)
+        vao = vboVerts = vboNormals = ebo = 0;
+        waterTex = dispTex = 0;
 
         // Generate the plane mesh
         planeMeshQuads(min, max, stepsize);
@@ -69,42 +185,154 @@ public:
                                     "WaterShader.tes",
                                     "WaterShader.geoshader",
                                     "WaterShader.fragmentshader");
+        foam.reset(new FoamMap());
 
         waterTex = loadTextureBMP("Assets/water.bmp"); // Load water texture
         dispTex = loadTextureBMP("Assets/displacement-map1.bmp"); // Load displacement map
 
         // Check if textures loaded successfully
         if (waterTex == 0 || dispTex == 0)
-            std::cerr << "⚠️ Warning: One or more textures failed to load.\n";
+            LOG_WARN("⚠️ Warning: One or more textures failed to load.");
 
         // Set up OpenGL buffers
-        glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
+        createBuffers();
+        createVertexArray();
+    }
 
-        // Vertex buffer
-        glGenBuffers(1, &vboVerts);
-        glBindBuffer(GL_ARRAY_BUFFER, vboVerts);
-        glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // Position attribute
-        glEnableVertexAttribArray(0);
+    // Constructor that only starts the CPU side of loading: plane generation, shader source reads and
+    // BMP decoding run as tasks of the startup graph and overlap with window and context creation.
+    // No GL calls are made here; call update() once per frame after the context exists.
+    // Shaders and textures are taken from the asset pack when it has them, from loose files otherwise.
+    PlaneMesh(float min, float max, float stepsize, TaskGraph& startup, const AssetPack* pack = nullptr) {
+        this->min = min;
+        this->max = max;
+        this->step = stepsize;
+        modelColor = glm::vec4(0, 1.0f, 1.0f, 1.0f); // Default color (cyan)
+        vao = vboVerts = vboNormals = ebo = 0;
+        waterTex = dispTex = 0;
+        shaderProgram = 0;
+        programLinked = false;
+        pendingLoads = 1; // The buffers; the textures start as placeholders
 
-        // Normal buffer
-        glGenBuffers(1, &vboNormals);
-        glBindBuffer(GL_ARRAY_BUFFER, vboNormals);
-        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // Normal attribute
-        glEnableVertexAttribArray(1);
+        geometryTask = startup.add([this, min, max, stepsize]() {
+            planeMeshQuads(min, max, stepsize);
+            numVerts = verts.size() / 3;
+            numIndices = indices.size();
+        });
+        this->pack = pack;
+        shaderTask = startup.add([this, pack]() {
+            const char* paths[5] = {"WaterShader.vertexshader",
+                                    "WaterShader.tcs",
+                                    "WaterShader.tes",
+                                    "WaterShader.geoshader",
+                                    "WaterShader.fragmentshader"};
+            shaderSources = pack ? readShaderSources(*pack, paths[0], paths[1], paths[2], paths[3], paths[4])
+                                 : readShaderSources(paths[0], paths[1], paths[2], paths[3], paths[4]);
+        });
+        startTexture(startup, water, "Assets/water.bmp");
+        startTexture(startup, disp, "Assets/displacement-map1.bmp");
+    }
 
-        // Element buffer
-        glGenBuffers(1, &ebo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), indices.data(), GL_STATIC_DRAW);
+    // Waits for startup tasks that still write into this object
+    ~PlaneMesh() {
+        for (const TaskGraph::Task& task : {geometryTask, shaderTask, water.task, disp.task})
+            if (task.valid()) task.wait();
+    }
 
-        glBindVertexArray(0); // Unbind VAO
+    PlaneMesh(const PlaneMesh&) = delete;
+    PlaneMesh& operator=(const PlaneMesh&) = delete;
+
+    // Function to delete the GL objects of the plane, including its foam map; draw() does nothing
+    // afterwards. Call it while the context is current: before replacing a plane, and before
+    // glfwTerminate() for a plane that outlives the context, since ~FoamMap deletes GL objects.
+    void release() {
+        glDeleteVertexArrays(1, &vao);
+        GLuint buffers[3] = {vboVerts, vboNormals, ebo};
+        glDeleteBuffers(3, buffers);
+        GLuint textures[2] = {waterTex, dispTex};
+        glDeleteTextures(2, textures);
+        glDeleteProgram(shaderProgram);
+        foam.reset();
+        vao = vboVerts = vboNormals = ebo = waterTex = dispTex = shaderProgram = 0;
+        programLinked = false;
     }
 
+    // Function to move the startup pipeline forward; call once per frame on the render thread.
+    // Hands every finished CPU task to the GPU without waiting for the others: buffers and textures
+    // go to the loader, the shader is compiled here (on driver threads with parallel shader compile)
+    // and polled until it has linked. The plane is drawn with placeholder textures (flat water, no
+    // displacement) as soon as the program and buffers are ready.
+    // Parameters:
+    // - loader: The background loader used for buffers and textures
+    void update(GLLoader& loader) {
+        if (!geometryTask.valid()) return; // Not built with the startup graph
+
+        if (waterTex == 0) {
+            // 1x1 placeholders (BGR) until the real textures arrive
+            BMPImage blue{1, 1, 3, {200, 120, 40}}, flat{1, 1, 3, {0, 0, 0}};
+            waterTex = uploadTextureBMP(blue);
+            dispTex = uploadTextureBMP(flat);
+        }
+
+        if (!buffersQueued && TaskGraph::finished(geometryTask)) {
+            buffersQueued = true;
+            loader.submit([this]() { createBuffers(); },
+                          [this]() { createVertexArray(); --pendingLoads; });
+        }
+
+        queueTexture(loader, water, waterTex);
+        queueTexture(loader, disp, dispTex);
+
+        if (!programLinking && !programLinked && TaskGraph::finished(shaderTask)) {
+            shaderProgram = compileProgram(shaderSources);
+            programLinking = true;
+        }
+        if (programLinking && programCompleted(shaderProgram)) {
+            checkProgram(shaderProgram);
+            programLinking = false;
+            programLinked = true;
+            foam.reset(new FoamMap(512, pack));
+        }
+    }
+
+    // Returns true once the program, buffers and textures (or their placeholders) exist
+    bool ready() const { return pendingLoads == 0 && programLinked; }
+
+    // Function to advance the foam map to the current time; call once per frame, before draw()
+    // (preferably outside the scene pass, since it renders into its own framebuffer)
+    void updateFoam() {
+        if (!ready() || !foam) return;
+        foam->update(waves, activeWaves, glm::vec2(min), max - min, static_cast<float>(glfwGetTime()));
+    }
+
+    // Function to set the tessellation levels of the patches
+    // Parameters:
+    // - outer: Level of the patch edges
+    // - inner: Level of the patch interior
+    void setTessellation(float outer, float inner) {
+        outerTess = outer;
+        innerTess = inner;
+    }
+
+    // Function to set how many waves of the table are drawn (the first ones are kept)
+    // Parameters:
+    // - count: Number of waves, clamped to the table size
+    void setWaveCount(int count) {
+        activeWaves = std::min(std::max(count, 0), static_cast<int>(waves.size()));
+    }
+
+    // Function to set the wave LOD: a wave is skipped where its wavelength covers fewer pixels than
+    // this, and fades out as it approaches that distance (0 keeps every wave everywhere)
+    void setWaveLod(float pixelsPerWavelength) { waveLodPixels = std::max(pixelsPerWavelength, 0.0f); }
+
+    float tessellation() const { return outerTess; }                     // Outer tessellation level
+    int waveCount() const { return activeWaves; }                         // Waves drawn
+    int maxWaveCount() const { return static_cast<int>(waves.size()); } // Waves in the table
+
     // Function to draw the plane mesh
     void draw(glm::vec3 lightPos, glm::mat4 V, glm::mat4 P) {
+        if (!ready()) return; // Still loading in the background
+
         glUseProgram(shaderProgram); // Use the shader program
 
         // Model, View, Projection matrices
@@ -123,12 +351,29 @@ public:
         glUniform1f(glGetUniformLocation(shaderProgram, "time"), glfwGetTime());
 
         // Pass tessellation and texture parameters to the shader
-        glUniform1f(glGetUniformLocation(shaderProgram, "outerTess"), 16.0f); // Outer tessellation level
-        glUniform1f(glGetUniformLocation(shaderProgram, "innerTess"), 16.0f); // Inner tessellation level
-        glUniform1f(glGetUniformLocation(shaderProgram, "texScale"), 10.0f);  // Texture scaling factor
+        glUniform1f(glGetUniformLocation(shaderProgram, "outerTess"), outerTess); // Outer tessellation level
+        glUniform1f(glGetUniformLocation(shaderProgram, "innerTess"), innerTess); // Inner tessellation level
+        const float texScale = 10.0f; // World units per texture repeat
+        glUniform1f(glGetUniformLocation(shaderProgram, "texScale"), texScale); // Texture scaling factor
         glUniform2f(glGetUniformLocation(shaderProgram, "texOffset"), 0.0f, 0.0f); // Texture offset
         glUniform4fv(glGetUniformLocation(shaderProgram, "modelcolor"), 1, glm::value_ptr(modelColor)); // Model color
 
+        // Pixels covered by one world unit at distance 1 from the eye, for the current viewport
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        float pixelsPerUnit = P[1][1] * 0.5f * viewport[3];
+
+        // Pass the active waves to the shader, each with the distance at which a wavelength shrinks
+        // to waveLodPixels on screen
+        setWaveUniforms(shaderProgram, waves, activeWaves);
+        float cutoffs[MAX_WAVES];
+        for (int i = 0; i < activeWaves; ++i) {
+            float wavelength = 2.0f * glm::pi<float>() / waves[i].frequency;
+            cutoffs[i] = waveLodPixels > 0.0f ? wavelength * pixelsPerUnit / waveLodPixels : 1e30f;
+        }
+        if (activeWaves > 0)
+            glUniform1fv(glGetUniformLocation(shaderProgram, "waveCutoffs"), activeWaves, cutoffs);
+
         // Bind and pass textures to the shader
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, waterTex);
@@ -138,6 +383,21 @@ public:
         glBindTexture(GL_TEXTURE_2D, dispTex);
         glUniform1i(glGetUniformLocation(shaderProgram, "displacementTexture"), 1);
 
+        // Foam accumulated by updateFoam(), stretched over the plane
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, foam ? foam->texture() : 0);
+        glUniform1i(glGetUniformLocation(shaderProgram, "foamTexture"), 2);
+        glUniform2f(glGetUniformLocation(shaderProgram, "foamOrigin"), min, min);
+        glUniform1f(glGetUniformLocation(shaderProgram, "foamSize"), max - min);
+        glActiveTexture(GL_TEXTURE1);
+
+        // Displacement map LOD, sampled per vertex where there are no derivatives to pick the mip
+        GLint dispSize = 1;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &dispSize);
+        float texelsPerUnit = dispSize / texScale;
+        glUniform1f(glGetUniformLocation(shaderProgram, "dispTexelsPerDistance"), texelsPerUnit / pixelsPerUnit);
+        glUniform1f(glGetUniformLocation(shaderProgram, "dispTexelsPerVertex"), texelsPerUnit * step / innerTess);
+
         // Draw the mesh using tessellation patches
         glBindVertexArray(vao);
         glPatchParameteri(GL_PATCH_VERTICES, 4); // Specify 4 vertices per patch
@@ -0,0 +1,149 @@
+#include "asset_pack.hpp"
+#include "log.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Check that the data of an entry holds everything its header fields describe, so that uploading
+// it never reads past the asset
+static bool entryFitsData(const PackEntry& entry) {
+    switch (entry.type) {
+    case PACK_TEXTURE: {
+        if (entry.levels < 1 || entry.levels > 32 || entry.width == 0 || entry.height == 0)
+            return false;
+        uint64_t total = 0;
+        uint32_t width = entry.width, height = entry.height;
+        for (uint32_t i = 0; i < entry.levels; ++i) {
+            total += packLevelSize(entry.format, width, height);
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        return total <= entry.size;
+    }
+    default:
+        return true;
+    }
+}
+
+// Map the pack and validate its table of contents
+AssetPack::AssetPack(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return; // No pack: the caller falls back to loose files
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(PackHeader))) {
+        close(fd);
+        return;
+    }
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Failed to map asset pack: {}", path);
+        return;
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(mapping);
+    size_t size = static_cast<size_t>(info.st_size);
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(bytes);
+    bool valid = std::memcmp(header->magic, "WPAK", 4) == 0 && header->version == PACK_VERSION &&
+                 sizeof(PackHeader) + static_cast<size_t>(header->count) * sizeof(PackEntry) <= size;
+    const PackEntry* toc = reinterpret_cast<const PackEntry*>(bytes + sizeof(PackHeader));
+    for (uint32_t i = 0; valid && i < header->count; ++i)
+        valid = toc[i].offset <= size && toc[i].size <= size - toc[i].offset &&
+                std::memchr(toc[i].name, 0, sizeof(toc[i].name)) != nullptr && entryFitsData(toc[i]);
+    if (!valid) {
+        LOG_ERROR("Invalid asset pack: {}", path);
+        munmap(mapping, size);
+        return;
+    }
+
+    base = bytes;
+    length = size;
+    entries = toc;
+    count = header->count;
+}
+
+// Unmap the pack
+AssetPack::~AssetPack() {
+    if (base)
+        munmap(const_cast<unsigned char*>(base), length);
+}
+
+// Binary search of the sorted table of contents
+const PackEntry* AssetPack::find(const char* name) const {
+    const PackEntry* end = entries + count;
+    const PackEntry* entry = std::lower_bound(entries, end, name, [](const PackEntry& e, const char* key) {
+        return std::strcmp(e.name, key) < 0;
+    });
+    if (entry == end || std::strcmp(entry->name, name) != 0)
+        return nullptr;
+    return entry;
+}
+
+// Hand out a pointer into the mapping, prefetching the asset's pages
+const unsigned char* AssetPack::data(const PackEntry& entry) const {
+    const unsigned char* start = base + entry.offset;
+    if (entry.size > 0)
+        madvise(const_cast<unsigned char*>(start), entry.size, MADV_WILLNEED); // offset is page-aligned
+    return start;
+}
+
+// Upload every mip level straight from the mapping
+GLuint AssetPack::uploadTexture(const PackEntry& entry) const {
+    bool compressed = entry.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (entry.type != PACK_TEXTURE || (compressed && !GLEW_EXT_texture_compression_s3tc))
+        return 0;
+
+    const unsigned char* level = data(entry);
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    uint32_t width = entry.width, height = entry.height;
+    for (uint32_t i = 0; i < entry.levels; ++i) {
+        size_t size = packLevelSize(entry.format, width, height);
+        if (compressed)
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, entry.format, width, height, 0, static_cast<GLsizei>(size), level);
+        else
+            glTexImage2D(GL_TEXTURE_2D, i, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, level);
+        level += size;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // Same filtering as uploadTextureBMP; the mips come from the pack
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
+
+// Read one shader stage from the pack, or from disk if the pack does not have it
+std::string readShaderSource(const AssetPack& pack, const char* path) {
+    const PackEntry* entry = pack.find(path);
+    if (entry == nullptr || entry->type != PACK_SHADER || entry->size == 0)
+        return readShaderFile(path);
+    return std::string(reinterpret_cast<const char*>(pack.data(*entry)), entry->size - 1); // Drop the NUL
+}
+
+// Take packed shader stages where available
+ShaderSources readShaderSources(const AssetPack& pack,
+                                const char* vertex_file_path,
+                                const char* tess_control_path,
+                                const char* tess_eval_path,
+                                const char* geometry_path,
+                                const char* fragment_file_path) {
+    ShaderSources sources;
+    sources.vertex      = readShaderSource(pack, vertex_file_path);
+    sources.tessControl = readShaderSource(pack, tess_control_path);
+    sources.tessEval    = readShaderSource(pack, tess_eval_path);
+    sources.geometry    = readShaderSource(pack, geometry_path);
+    sources.fragment    = readShaderSource(pack, fragment_file_path);
+    return sources;
+}
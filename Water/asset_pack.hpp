@@ -0,0 +1,124 @@
+#pragma once
+
+#include "shader_utils.hpp"
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstddef>
+
+// Asset pack: shaders and textures in one file built by pack_builder.
+//
+// Layout (all integers little-endian):
+//   PackHeader
+//   PackEntry[count]          Table of contents, sorted by name
+//   asset data                Each asset starts on a PACK_ALIGNMENT boundary
+//
+// The file is mapped read-only at startup. Opening it touches only the header and the table of
+// contents; the pages of an asset are read in when it is first accessed, so cold-start I/O is a
+// few page faults instead of one open/read/close per loose file.
+
+const uint32_t PACK_VERSION = 1;
+const uint64_t PACK_ALIGNMENT = 4096; // Page size: no two assets share a page
+
+enum PackAssetType : uint32_t {
+    PACK_SHADER = 1,  // NUL-terminated GLSL source, passed to glShaderSource as is
+    PACK_TEXTURE = 2, // Every mip level, largest first, in the GL internal format of the entry
+};
+
+struct PackHeader {
+    char magic[4];      // "WPAK"
+    uint32_t version;   // PACK_VERSION
+    uint32_t count;     // Number of entries in the table of contents
+    uint32_t reserved;
+};
+
+struct PackEntry {
+    char name[64];          // Path of the source file relative to the program directory, NUL-terminated
+    uint32_t type;          // PackAssetType
+    uint32_t format;        // Textures: GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_R8
+    uint32_t width, height; // Textures: size of level 0
+    uint32_t levels;        // Textures: number of mip levels
+    uint32_t reserved[3];
+    uint64_t offset;        // Start of the data from the beginning of the file
+    uint64_t size;          // Size of the data in bytes
+};
+
+static_assert(sizeof(PackHeader) == 16, "PackHeader layout");
+static_assert(sizeof(PackEntry) == 112, "PackEntry layout");
+
+// Function to compute the size of one mip level of a packed texture
+// Parameters:
+// - format: GL_COMPRESSED_RGB_S3TC_DXT1_EXT (8 bytes per 4x4 block) or GL_R8 (1 byte per texel)
+// - width, height: Size of the level
+// Returns:
+// - size_t: Size of the level in bytes
+inline size_t packLevelSize(uint32_t format, uint32_t width, uint32_t height) {
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+    return static_cast<size_t>(width) * height;
+}
+
+// A memory-mapped asset pack
+class AssetPack {
+public:
+    // Constructor: maps the pack; leaves it closed (isOpen() false) if the file is missing or invalid
+    // Parameters:
+    // - path: Path to the pack file
+    AssetPack(const char* path);
+
+    // Unmaps the pack; pointers returned by data() become invalid
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Returns true if the pack was mapped
+    bool isOpen() const { return base != nullptr; }
+
+    // Function to look an asset up in the table of contents
+    // Parameters:
+    // - name: Path the asset was packed from (e.g. "Assets/water.bmp")
+    // Returns:
+    // - const PackEntry*: The entry, or nullptr if the pack is closed or has no such asset
+    const PackEntry* find(const char* name) const;
+
+    // Function to access the data of an asset; asks the kernel to read the whole asset in at once
+    // Returns:
+    // - const unsigned char*: Start of the asset data inside the mapping
+    const unsigned char* data(const PackEntry& entry) const;
+
+    // Function to create a texture from a packed asset on the current context
+    // Parameters:
+    // - entry: A PACK_TEXTURE entry
+    // Returns:
+    // - GLuint: The texture ID, or 0 if the context does not support the format
+    GLuint uploadTexture(const PackEntry& entry) const;
+
+private:
+    const unsigned char* base = nullptr; // Start of the mapping
+    size_t length = 0;                   // Size of the mapping
+    const PackEntry* entries = nullptr;  // Table of contents
+    uint32_t count = 0;
+};
+
+// Function to read one shader file from the pack if it is there and from disk otherwise; makes no GL calls
+// Parameters:
+// - pack: The asset pack (may be closed)
+// - path: Path of the shader file
+// Returns:
+// - std::string: The source code (empty if the file could not be read)
+std::string readShaderSource(const AssetPack& pack, const char* path);
+
+// Function to read the five shader stages, taking each one from the pack if it is there and from
+// disk otherwise; makes no GL calls
+// Parameters:
+// - pack: The asset pack (may be closed)
+// - vertex_file_path ... fragment_file_path: Same as LoadShaders
+// Returns:
+// - ShaderSources: The sources of the five stages
+ShaderSources readShaderSources(const AssetPack& pack,
+                                const char* vertex_file_path,
+                                const char* tess_control_path,
+                                const char* tess_eval_path,
+                                const char* geometry_path,
+                                const char* fragment_file_path);
@@ -0,0 +1,104 @@
+#include "detail_tuner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Constructor: clamps the bounds and the starting detail
+DetailTuner::DetailTuner(float budgetMs, const DetailBounds& bounds, float tess, int waves)
+    : budgetMs(budgetMs), bounds(bounds) {
+    this->bounds.minTess = std::max(this->bounds.minTess, 1.0f);
+    this->bounds.maxTess = std::max(this->bounds.maxTess, this->bounds.minTess);
+    this->bounds.minWaves = std::max(this->bounds.minWaves, 0);
+    this->bounds.maxWaves = std::max(this->bounds.maxWaves, this->bounds.minWaves);
+    this->tess = std::min(std::max(tess, this->bounds.minTess), this->bounds.maxTess);
+    this->waves = std::min(std::max(waves, this->bounds.minWaves), this->bounds.maxWaves);
+}
+
+// Timestamp queries are core in OpenGL 3.3
+bool DetailTuner::supported() {
+    return GLEW_ARB_timer_query;
+}
+
+void DetailTuner::beginPass() {
+    timer.begin();
+}
+
+void DetailTuner::endPass() {
+    timer.end();
+}
+
+// Lowers the detail one step: tessellation by the square root of the overshoot (at least 20%, at
+// most half), or one wave once tessellation is at its minimum
+bool DetailTuner::lower(double ms) {
+    tessCeiling = tess; // Too slow here; not raised back to it for a while
+    ceilingHold = CeilingFrames;
+    if (tess > bounds.minTess) {
+        float factor = static_cast<float>(std::sqrt(budgetMs / ms));
+        factor = std::min(std::max(factor, 0.5f), 0.8f);
+        tess = std::max(bounds.minTess, std::floor(tess * factor)); // Whole levels (equal spacing)
+        return true;
+    }
+    if (waves > bounds.minWaves) {
+        --waves;
+        return true;
+    }
+    return false;
+}
+
+// Raises the detail one step if the pass is predicted to stay within the budget afterwards: one
+// wave back (assuming the pass time grows with the wave count), or as much tessellation as fits
+// 90% of the budget (assuming it grows with the square of the level) once every wave is drawn,
+// staying below a level that recently went over budget
+bool DetailTuner::raise(double ms) {
+    if (waves < bounds.maxWaves) {
+        if (ms * (waves + 1) / std::max(waves, 1) > budgetMs) return false;
+        ++waves;
+        return true;
+    }
+    if (tess < bounds.maxTess) {
+        float fit = std::floor(tess * static_cast<float>(std::sqrt(0.9 * budgetMs / std::max(ms, 1e-3))));
+        fit = std::min(fit, bounds.maxTess);
+        if (ceilingHold > 0) fit = std::min(fit, tessCeiling - 1.0f);
+        if (fit <= tess) return false;
+        tess = fit;
+        return true;
+    }
+    return false;
+}
+
+// Counts consecutive measurements on each side of the dead band and steps the detail when enough agree
+bool DetailTuner::update() {
+    bool changed = false;
+    double ms;
+    while (timer.result(ms)) {
+        lastMs = ms;
+        if (ceilingHold > 0) --ceilingHold;
+        if (settling > 0) { // Drawn before the last change
+            --settling;
+            continue;
+        }
+
+        if (ms > budgetMs) {
+            ++overCount;
+            underCount = 0;
+        } else if (ms < UnderBudget * budgetMs) {
+            ++underCount;
+            overCount = 0;
+        } else {
+            overCount = underCount = 0;
+        }
+
+        bool stepped = false;
+        if (overCount >= FramesToLower)
+            stepped = lower(ms);
+        else if (underCount >= FramesToRaise)
+            stepped = raise(ms);
+        if (overCount >= FramesToLower || underCount >= FramesToRaise)
+            overCount = underCount = 0;
+        if (stepped) {
+            settling = GpuTimer::Latency;
+            changed = true;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "gpu_timer.hpp"
+
+// Limits the detail tuner stays within
+struct DetailBounds {
+    float minTess = 2.0f;  // Lowest tessellation level
+    float maxTess = 64.0f; // Highest tessellation level
+    int minWaves = 2;      // Fewest Gerstner waves
+    int maxWaves = 16;     // Most Gerstner waves (further clamped to the wave table)
+};
+
+// Frame-budget auto-tuner for the water surface detail.
+// Times the water pass on the GPU and moves the tessellation level, then the number of waves,
+// to keep the pass within a budget. Over budget, tessellation is lowered first (the generated
+// triangle count grows with its square) and waves are dropped only once it is at its minimum;
+// with headroom, waves come back first, then tessellation. To avoid oscillating between two
+// levels the tuner only acts after several consecutive measurements agree, ignores times between
+// UnderBudget and 100% of the budget, waits for the frames already in flight to be measured at the
+// new level before acting again, takes longer to raise detail than to lower it, only raises it
+// when the predicted time still fits the budget, and keeps away from a level that was too slow.
+class DetailTuner {
+public:
+    static constexpr float UnderBudget = 0.7f; // Detail is raised below this fraction of the budget
+    static const int FramesToLower = 3;        // Consecutive measurements over budget before lowering
+    static const int FramesToRaise = 12;       // Consecutive measurements under budget before raising
+    static const int CeilingFrames = 240;      // Measurements a level that went over budget is avoided for
+
+    // Constructor
+    // Parameters:
+    // - budgetMs: Target GPU time of the water pass, in milliseconds
+    // - bounds: Limits of the tessellation level and wave count
+    // - tess, waves: Starting detail (clamped to the bounds)
+    DetailTuner(float budgetMs, const DetailBounds& bounds, float tess, int waves);
+
+    DetailTuner(const DetailTuner&) = delete;
+    DetailTuner& operator=(const DetailTuner&) = delete;
+
+    // Returns true if the context can time the GPU
+    static bool supported();
+
+    // Functions to bracket the water pass; they can be nested inside other GPU timers
+    void beginPass();
+    void endPass();
+
+    // Function to read the finished measurements and adjust the detail
+    // Returns:
+    // - bool: True if tessellation() or waveCount() changed
+    bool update();
+
+    float tessellation() const { return tess; } // Tessellation level to draw with
+    int waveCount() const { return waves; }     // Number of waves to draw
+    double passMs() const { return lastMs; }    // Last measured GPU time of the pass (0 before the first)
+
+private:
+    bool lower(double ms);
+    bool raise(double ms);
+
+    GpuTimer timer;
+    float budgetMs;
+    DetailBounds bounds;
+    float tess;
+    int waves;
+    double lastMs = 0.0;
+    int overCount = 0, underCount = 0; // Consecutive measurements over / well under budget
+    int settling = 0;                  // Measurements still taken at the previous detail
+    float tessCeiling = 0.0f;          // Last tessellation level that went over budget
+    int ceilingHold = 0;               // Measurements left before tessCeiling may be tried again
+};
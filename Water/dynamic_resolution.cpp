@@ -0,0 +1,108 @@
+#include "dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Constructor: the targets are allocated by the first beginFrame()
+DynamicResolution::DynamicResolution(float budgetMs, int samples, float minScale)
+    : budgetMs(budgetMs), minScale(std::min(std::max(minScale, 0.05f), 1.0f)), samples(std::max(samples, 1)) {}
+
+// Destructor: releases the offscreen targets
+DynamicResolution::~DynamicResolution() {
+    release();
+}
+
+// Timestamp queries are core in OpenGL 3.3
+bool DynamicResolution::supported() {
+    return GLEW_ARB_timer_query;
+}
+
+// Creates the scene and resolve targets at full window size
+void DynamicResolution::allocate(int width, int height) {
+    release();
+    this->width = width;
+    this->height = height;
+
+    glGenRenderbuffers(1, &sceneColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneColor);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &sceneDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+    glGenFramebuffers(1, &sceneFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+
+    glGenRenderbuffers(1, &resolveColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, resolveColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &resolveFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, resolveFbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveColor);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Deletes the targets
+void DynamicResolution::release() {
+    glDeleteFramebuffers(1, &sceneFbo);
+    glDeleteFramebuffers(1, &resolveFbo);
+    glDeleteRenderbuffers(1, &sceneColor);
+    glDeleteRenderbuffers(1, &sceneDepth);
+    glDeleteRenderbuffers(1, &resolveColor);
+    sceneFbo = resolveFbo = sceneColor = sceneDepth = resolveColor = 0;
+}
+
+// Redirects the frame into the scaled offscreen target
+void DynamicResolution::beginFrame(int width, int height) {
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (width != this->width || height != this->height)
+        allocate(width, height);
+
+    sceneWidth = std::max(1, static_cast<int>(std::lround(width * currentScale)));
+    sceneHeight = std::max(1, static_cast<int>(std::lround(height * currentScale)));
+
+    if (timer.begin())
+        timedScales.push_back(currentScale);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+    glViewport(0, 0, sceneWidth, sceneHeight);
+
+    // Keep clears to the used corner of the target as well
+    glScissor(0, 0, sceneWidth, sceneHeight);
+    glEnable(GL_SCISSOR_TEST);
+}
+
+// Resolves, upscales and adapts the scale
+void DynamicResolution::endFrame() {
+    // Resolve the samples at the scene size, then stretch to the window
+    glDisable(GL_SCISSOR_TEST); // It would clip the blits
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFbo);
+    glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, sceneWidth, sceneHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    timer.end();
+
+    // Scale the pixel count by budget / measured time, relative to the scale the measured frame was
+    // drawn at. Changes under 5% are ignored and larger ones are applied halfway, so the scale
+    // settles instead of chasing the noise of single frames.
+    double ms;
+    while (timer.result(ms)) {
+        float measuredScale = timedScales.front();
+        timedScales.pop_front();
+        lastMs = ms;
+        if (ms <= 0.0) continue;
+        float target = measuredScale * static_cast<float>(std::sqrt(budgetMs / ms));
+        target = std::min(std::max(target, minScale), 1.0f);
+        if (std::fabs(target - currentScale) > 0.05f * currentScale)
+            currentScale += 0.5f * (target - currentScale);
+        else if (target == 1.0f)
+            currentScale = 1.0f; // Back to full resolution once there is headroom
+    }
+}
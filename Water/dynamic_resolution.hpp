@@ -0,0 +1,61 @@
+#pragma once
+
+#include "gpu_timer.hpp"
+
+#include <GL/glew.h>
+#include <deque>
+
+// Dynamic resolution scaling.
+// The scene is drawn into an offscreen multisampled target at a fraction of the window size, then
+// resolved and stretched onto the window with framebuffer blits. The fraction is adjusted every
+// frame from the measured GPU time of the previous frames so that the frame stays within a time
+// budget: fragment cost is roughly proportional to the pixel count, i.e. to the square of the scale.
+// The targets are allocated once at full window size; changing the scale only changes the viewport.
+// The window itself must be created without multisampling (blits into a multisampled framebuffer
+// are not allowed).
+class DynamicResolution {
+public:
+    // Constructor
+    // Parameters:
+    // - budgetMs: Target GPU time of a frame, in milliseconds
+    // - samples: Multisample count of the offscreen target
+    // - minScale: Lowest allowed fraction of the window size per axis
+    DynamicResolution(float budgetMs, int samples = 4, float minScale = 0.5f);
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // Returns true if the context can time the GPU (required to adapt the scale)
+    static bool supported();
+
+    // Function to start a frame: binds the offscreen target and sets the viewport to the scaled size
+    // Parameters:
+    // - width, height: Framebuffer size of the window (the targets are reallocated when it changes)
+    void beginFrame(int width, int height);
+
+    // Function to finish a frame: resolves and upscales into the window's framebuffer, then picks the
+    // scale of a later frame from the newest GPU time available
+    void endFrame();
+
+    // Returns the current fraction of the window size per axis
+    float scale() const { return currentScale; }
+
+    // Returns the last measured GPU time of a frame, in milliseconds (0 before the first measurement)
+    double gpuMs() const { return lastMs; }
+
+private:
+    void allocate(int width, int height);
+    void release();
+
+    GpuTimer timer;
+    float budgetMs, minScale;
+    int samples;
+    float currentScale = 1.0f;
+    double lastMs = 0.0;
+    std::deque<float> timedScales;       // Scale of every frame whose GPU time is still in flight
+    int width = 0, height = 0;           // Window size the targets were allocated for
+    int sceneWidth = 0, sceneHeight = 0; // Size rendered this frame
+    GLuint sceneFbo = 0, sceneColor = 0, sceneDepth = 0; // Multisampled scene target
+    GLuint resolveFbo = 0, resolveColor = 0;             // Single-sample copy of the scene
+};
@@ -0,0 +1,83 @@
+#include "foam_map.hpp"
+#include "shader_utils.hpp"
+
+#include <algorithm>
+
+// Constructor: two cleared single-channel float textures, each with its own framebuffer
+FoamMap::FoamMap(int size, const AssetPack* pack) : size(std::max(size, 1)) {
+    if (pack)
+        program = buildProgram(readShaderSource(*pack, "FoamShader.vertexshader"),
+                               readShaderSource(*pack, "FoamShader.fragmentshader"));
+    else
+        program = LoadShaders("FoamShader.vertexshader", "FoamShader.fragmentshader");
+    glGenVertexArrays(1, &vao); // The full-screen triangle has no attributes, but core needs a VAO
+
+    GLint previousFbo;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGenTextures(2, textures);
+    glGenFramebuffers(2, fbos);
+    for (int i = 0; i < 2; ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, this->size, this->size, 0, GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+        GLfloat zero[4] = {0, 0, 0, 0};
+        glClearBufferfv(GL_COLOR, 0, zero); // No foam to begin with
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+}
+
+// Destructor: releases the GL objects
+FoamMap::~FoamMap() {
+    glDeleteFramebuffers(2, fbos);
+    glDeleteTextures(2, textures);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+}
+
+// Renders the next foam state from the current one into the other texture
+void FoamMap::update(const std::vector<GerstnerWave>& waves, int waveCount, glm::vec2 origin, float extent, float time) {
+    // Long pauses (and the first update) only decay as much as a tenth of a second would
+    float deltaTime = lastTime < 0.0f ? 0.0f : std::min(std::max(time - lastTime, 0.0f), 0.1f);
+    lastTime = time;
+
+    GLint previousFbo, viewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST), scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+
+    int next = 1 - current;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[next]);
+    glViewport(0, 0, size, size);
+
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[current]);
+    glUniform1i(glGetUniformLocation(program, "previousFoam"), 0);
+    glUniform2f(glGetUniformLocation(program, "foamOrigin"), origin.x, origin.y);
+    glUniform1f(glGetUniformLocation(program, "foamSize"), extent);
+    glUniform1f(glGetUniformLocation(program, "time"), time);
+    glUniform1f(glGetUniformLocation(program, "deltaTime"), deltaTime);
+    glUniform1f(glGetUniformLocation(program, "jacobianThreshold"), JacobianThreshold);
+    glUniform1f(glGetUniformLocation(program, "foamGain"), Gain);
+    glUniform1f(glGetUniformLocation(program, "foamLifetime"), Lifetime);
+    setWaveUniforms(program, waves, waveCount);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    current = next;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+    if (scissorTest) glEnable(GL_SCISSOR_TEST);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "waves.hpp"
+#include "asset_pack.hpp"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Low-resolution foam accumulation map over the water plane.
+// Each update runs one full-screen pass over a small square texture: every texel evaluates the
+// Jacobian determinant of the Gerstner displacement at the plane position it covers, adds foam where
+// the surface is compressed (crests) and decays the foam of the previous update, which is read from
+// a second texture (ping-pong). The water shader samples the result once per fragment, so the cost
+// of foam depends only on the map size, not on the screen resolution or the tessellation level.
+class FoamMap {
+public:
+    static constexpr float JacobianThreshold = 0.72f; // Foam forms below this (about 1.5% of the default sea at a time)
+    static constexpr float Gain = 40.0f;             // Foam added per second per unit below the threshold
+    static constexpr float Lifetime = 1.0f;          // Seconds for foam to decay to 1/e
+
+    // Constructor: creates the textures and the update program; needs a current context
+    // Parameters:
+    // - size: Width and height of the map in texels
+    // - pack: Asset pack to take the FoamShader stages from (loose files if null or not in the pack)
+    explicit FoamMap(int size = 512, const AssetPack* pack = nullptr);
+    ~FoamMap();
+
+    FoamMap(const FoamMap&) = delete;
+    FoamMap& operator=(const FoamMap&) = delete;
+
+    // Function to advance the foam to a new time. Renders into its own framebuffer; the framebuffer,
+    // viewport, depth and scissor test bindings of the caller are restored afterwards.
+    // Parameters:
+    // - waves, waveCount: The waves drawn on the plane
+    // - origin: World xz of the corner of the area covered by the map
+    // - extent: World size of that area
+    // - time: Animation time, in seconds (the same as the water shader's)
+    void update(const std::vector<GerstnerWave>& waves, int waveCount, glm::vec2 origin, float extent, float time);
+
+    // Returns the texture holding the latest foam (red channel, 0 to 1)
+    GLuint texture() const { return textures[current]; }
+
+private:
+    int size;
+    GLuint program = 0, vao = 0;
+    GLuint textures[2] = {0, 0}, fbos[2] = {0, 0};
+    int current = 0;        // Texture written by the last update
+    float lastTime = -1.0f; // Time of the last update (negative before the first)
+};
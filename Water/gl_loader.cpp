@@ -0,0 +1,101 @@
+#include "gl_loader.hpp"
+#include "log.hpp"
+
+// Constructor: creates the invisible shared context and starts the loader thread
+GLLoader::GLLoader(GLFWwindow* mainWindow) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    context = glfwCreateWindow(1, 1, "loader", NULL, mainWindow);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (context == NULL)
+        LOG_WARN("Failed to create the loader context; loading on the render thread");
+    else
+        thread = std::thread(&GLLoader::run, this);
+}
+
+// Destructor: drains the queue, then stops the thread and releases the context
+GLLoader::~GLLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (thread.joinable())
+        thread.join();
+    for (Finished& job : finished)
+        glDeleteSync(job.fence);
+    if (context != NULL)
+        glfwDestroyWindow(context);
+}
+
+// Queues a job for the loader thread
+void GLLoader::submit(std::function<void()> load, std::function<void()> ready) {
+    if (context == NULL) {
+        // No shared context: load synchronously, the callback still runs from poll()
+        load();
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(ready)});
+        ++inFlight;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({std::move(load), std::move(ready)});
+        ++inFlight;
+    }
+    wake.notify_one();
+}
+
+// Loader thread: runs jobs with the shared context current and fences each one
+void GLLoader::run() {
+    glfwMakeContextCurrent(context);
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || !queue.empty(); });
+            if (queue.empty()) break; // Stopping and drained
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        job.load();
+
+        // The fence must reach the GPU before another context can wait on it
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back({fence, std::move(job.ready)});
+    }
+    glfwMakeContextCurrent(NULL);
+}
+
+// Runs the callbacks of the jobs whose fence has signalled, stopping at the first one still in flight
+// so that a later upload of the same object never lands before an earlier one
+int GLLoader::poll() {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t done = 0;
+        while (done < finished.size()) {
+            GLenum status = glClientWaitSync(finished[done].fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+            glDeleteSync(finished[done].fence);
+            ready.push_back(std::move(finished[done].ready));
+            ++done;
+        }
+        finished.erase(finished.begin(), finished.begin() + done);
+        inFlight -= static_cast<int>(done);
+    }
+
+    // Outside the lock, so callbacks may submit new jobs
+    for (auto& callback : ready)
+        callback();
+    return static_cast<int>(ready.size());
+}
+
+// Returns the number of jobs still loading or waiting for poll()
+int GLLoader::pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return inFlight;
+}
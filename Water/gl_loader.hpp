@@ -0,0 +1,69 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Background loader for OpenGL resources.
+// Owns an invisible window whose context shares objects with the main window, made current on a
+// loader thread. Jobs create and fill buffers and textures there; each job is followed by a fence,
+// and its completion callback runs on the render thread (in poll()) once the GPU has finished the
+// upload, so the frame loop never waits on file I/O, decoding or transfers.
+// Vertex array objects are not shared between contexts: create them in the completion callback.
+class GLLoader {
+public:
+    // Constructor: creates the shared context and starts the loader thread.
+    // Must be called on the main thread (GLFW creates windows there only), with the same window
+    // hints that were used for the main window.
+    // Parameters:
+    // - mainWindow: The window whose context the loaded objects are shared with
+    GLLoader(GLFWwindow* mainWindow);
+
+    // Finishes the queued jobs, then stops the thread and destroys the shared context.
+    // Completion callbacks that were not polled yet are dropped. Call before glfwTerminate().
+    ~GLLoader();
+
+    GLLoader(const GLLoader&) = delete;
+    GLLoader& operator=(const GLLoader&) = delete;
+
+    // Queues a job.
+    // Parameters:
+    // - load: Runs on the loader thread with the shared context current
+    // - ready: Runs on the render thread from poll() once everything load issued has completed
+    void submit(std::function<void()> load, std::function<void()> ready);
+
+    // Runs the completion callbacks of finished jobs, in submission order. Call once per frame on the
+    // render thread; it never blocks on the GPU.
+    // Returns:
+    // - int: The number of callbacks that ran
+    int poll();
+
+    // Returns the number of submitted jobs whose completion callback has not run yet.
+    int pending();
+
+private:
+    struct Job {
+        std::function<void()> load, ready;
+    };
+    struct Finished {
+        GLsync fence;
+        std::function<void()> ready;
+    };
+
+    void run();
+
+    GLFWwindow* context;                 // Invisible window holding the shared context
+    std::thread thread;
+    std::mutex mutex;                    // Guards queue, finished, inFlight and stopping
+    std::condition_variable wake;
+    std::deque<Job> queue;               // Jobs not started yet
+    std::vector<Finished> finished;      // Jobs loaded, waiting for their fence
+    int inFlight = 0;                    // Submitted jobs whose callback has not run
+    bool stopping = false;
+};
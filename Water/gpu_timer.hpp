@@ -0,0 +1,68 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// GPU timer built on GL_TIMESTAMP queries (OpenGL 3.3 / GL_ARB_timer_query).
+// Each interval is a pair of timestamps, so timers can be nested or overlapped (GL_TIME_ELAPSED
+// queries cannot). Keeps a small ring of query pairs so that reading a result never waits for the
+// GPU: the result of a frame is picked up a few frames later, once the driver reports it available.
+// Results come back in the order the intervals were measured.
+class GpuTimer {
+public:
+    static const int Latency = 4; // Frames that can be in flight
+
+    GpuTimer() {
+        glGenQueries(Latency, starts);
+        glGenQueries(Latency, ends);
+    }
+    ~GpuTimer() {
+        glDeleteQueries(Latency, starts);
+        glDeleteQueries(Latency, ends);
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Function to start timing the GPU commands that follow
+    // Returns:
+    // - bool: False if every query is still in flight; this interval is then not measured
+    bool begin() {
+        active = pending < Latency;
+        if (active) glQueryCounter(starts[next], GL_TIMESTAMP);
+        return active;
+    }
+
+    // Stops timing
+    void end() {
+        if (!active) return;
+        glQueryCounter(ends[next], GL_TIMESTAMP);
+        next = (next + 1) % Latency;
+        ++pending;
+        active = false;
+    }
+
+    // Function to fetch the oldest finished measurement without blocking
+    // Parameters:
+    // - ms: Receives the GPU time between begin() and end(), in milliseconds
+    // Returns:
+    // - bool: True if a new measurement was available
+    bool result(double& ms) {
+        if (pending == 0) return false;
+        int oldest = (next - pending + Latency) % Latency;
+        GLint available = 0;
+        glGetQueryObjectiv(ends[oldest], GL_QUERY_RESULT_AVAILABLE, &available); // The start is older
+        if (!available) return false;
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(starts[oldest], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(ends[oldest], GL_QUERY_RESULT, &end);
+        --pending;
+        ms = (end - start) * 1e-6;
+        return true;
+    }
+
+private:
+    GLuint starts[Latency], ends[Latency];
+    int next = 0;    // Query pair used by the next begin()
+    int pending = 0; // Pairs ended but not read yet
+    bool active = false;
+};
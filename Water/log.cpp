@@ -0,0 +1,191 @@
+#include "log.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using log_detail::Arg;
+using log_detail::Record;
+
+// Single-producer single-consumer ring of records: the owning thread writes, the drain reads
+struct Ring {
+    static const std::size_t Capacity = 1024;
+    Record slots[Capacity];
+    std::atomic<std::uint64_t> head{0}; // Next record to write (owning thread)
+    std::atomic<std::uint64_t> tail{0}; // Next record to read (drain, under the logger mutex)
+    std::atomic<bool> owned{true};      // False once the owning thread has exited
+};
+
+class Logger {
+public:
+    Logger() : drain(&Logger::run, this) {}
+
+    // Stops the drain thread and writes what is left
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        drain.join();
+        flush();
+    }
+
+    // Gives the calling thread a ring: an empty one left by an exited thread, or a new one
+    Ring* acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& ring : rings)
+            if (!ring->owned && ring->head == ring->tail) {
+                ring->owned = true;
+                return ring.get();
+            }
+        rings.push_back(std::make_unique<Ring>());
+        return rings.back().get();
+    }
+
+    // Formats and writes every committed record of every ring, oldest first
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.clear();
+        heads.resize(rings.size());
+        for (std::size_t r = 0; r < rings.size(); ++r) {
+            heads[r] = rings[r]->head.load(std::memory_order_acquire);
+            for (std::uint64_t i = rings[r]->tail.load(std::memory_order_relaxed); i != heads[r]; ++i)
+                pending.push_back(&rings[r]->slots[i % Ring::Capacity]);
+        }
+        std::stable_sort(pending.begin(), pending.end(),
+                         [](const Record* a, const Record* b) { return a->timestamp < b->timestamp; });
+
+        bool out = false, err = false;
+        for (Record* record : pending) {
+            bool error = record->level >= LOG_LEVEL_WARN;
+            format(error ? std::cerr : std::cout, *record);
+            (error ? err : out) = true;
+        }
+        if (out) std::cout.flush();
+        if (err) std::cerr.flush();
+
+        // Hand the slots back to their threads only now that they have been read
+        for (std::size_t r = 0; r < rings.size(); ++r)
+            rings[r]->tail.store(heads[r], std::memory_order_release);
+    }
+
+    // Asks the drain thread to run now rather than at its next interval
+    void nudge() { wake.notify_one(); }
+
+    std::atomic<std::uint64_t> dropped{0};
+
+private:
+    static constexpr int DrainIntervalMs = 5;
+
+    // Drain thread: flushes periodically until the logger is destroyed
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake.wait_for(lock, std::chrono::milliseconds(DrainIntervalMs));
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    // Writes one message, substituting the arguments for the "{}" in its format
+    static void format(std::ostream& stream, Record& record) {
+        if (record.level == LOG_LEVEL_DEBUG) stream << "[debug] ";
+        int next = 0;
+        for (const char* c = record.format; *c; ++c) {
+            if (c[0] == '{' && c[1] == '}' && next < record.argc) {
+                write(stream, record, record.args[next++]);
+                ++c;
+            } else {
+                stream << *c;
+            }
+        }
+        stream << '\n';
+        for (int i = 0; i < record.argc; ++i)
+            if (record.args[i].type == Arg::HeapText) delete[] record.args[i].heap;
+    }
+
+    static void write(std::ostream& stream, const Record& record, const Arg& arg) {
+        switch (arg.type) {
+        case Arg::Int: stream << arg.i; break;
+        case Arg::UInt: stream << arg.u; break;
+        case Arg::Double: stream << arg.d; break;
+        case Arg::Bool: stream << (arg.u ? "true" : "false"); break;
+        case Arg::Char: stream << static_cast<char>(arg.i); break;
+        case Arg::Text: stream.write(record.text + arg.text.offset, arg.text.length); break;
+        case Arg::HeapText: stream << arg.heap; break;
+        }
+    }
+
+    std::mutex mutex; // Serializes the consumer side of every ring and the ring list
+    std::condition_variable wake;
+    bool stopping = false;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Record*> pending;     // Records being written by flush()
+    std::vector<std::uint64_t> heads; // Head of each ring when flush() started
+    std::thread drain;
+};
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+// The calling thread's ring, returned to the logger when the thread exits
+struct ThreadRing {
+    Ring* ring = logger().acquire();
+    std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ~ThreadRing() { ring->owned.store(false, std::memory_order_release); }
+};
+
+ThreadRing& thread_ring() {
+    thread_local ThreadRing local;
+    return local;
+}
+
+} // namespace
+
+namespace log_detail {
+
+Record* begin_record() {
+    ThreadRing& local = thread_ring();
+    Ring* ring = local.ring;
+    if (local.head - ring->tail.load(std::memory_order_acquire) >= Ring::Capacity) {
+        logger().dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &ring->slots[local.head % Ring::Capacity];
+}
+
+void commit_record() {
+    ThreadRing& local = thread_ring();
+    local.ring->head.store(++local.head, std::memory_order_release);
+
+    // Wake the drain once per half ring when messages come faster than its interval
+    if (local.head - local.ring->tail.load(std::memory_order_relaxed) == Ring::Capacity / 2)
+        logger().nudge();
+}
+
+std::int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace log_detail
+
+void log_flush() {
+    logger().flush();
+}
+
+std::uint64_t log_dropped() {
+    return logger().dropped.load(std::memory_order_relaxed);
+}
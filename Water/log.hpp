@@ -0,0 +1,139 @@
+// Low-overhead logging facility for hot paths (the render loop, loader threads).
+// A log call copies its format string pointer and arguments into a ring buffer owned by the calling
+// thread, without locks or formatting; a background thread drains every ring, formats the messages
+// in time order and writes them to std::cout (debug, info) or std::cerr (warnings, errors).
+// Messages below LOG_MIN_LEVEL are removed at compile time, arguments included.
+//
+// Usage: LOG_WARN("Failed to open BMP: {}", path);
+// Each "{}" in the format is replaced by the next argument. The format must be a string literal;
+// arguments can be integers, floating point numbers, bools, characters and strings (copied).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum LogLevel { LOG_LEVEL_DEBUG = 0, LOG_LEVEL_INFO = 1, LOG_LEVEL_WARN = 2, LOG_LEVEL_ERROR = 3 };
+
+// Lowest level compiled in; build with -DLOG_MIN_LEVEL=0 to keep debug messages
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_AT(level, ...) \
+    do { if constexpr ((level) >= LOG_MIN_LEVEL) log_message((level), __VA_ARGS__); } while (0)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// Writes every message logged so far (by any thread) before returning. Errors are flushed this way
+// as soon as they are logged; call it before output that must come after the log messages.
+void log_flush();
+
+// Returns the number of messages dropped because a thread's ring buffer was full
+std::uint64_t log_dropped();
+
+namespace log_detail {
+
+const int MaxArgs = 10;
+const int TextSize = 128; // Bytes for copies of short string arguments
+
+// One captured argument
+struct Arg {
+    enum Type : std::uint8_t { Int, UInt, Double, Bool, Char, Text, HeapText } type;
+    union {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        struct { std::uint16_t offset, length; } text; // Inside Record::text
+        char* heap;                                     // Strings too long for Record::text (freed by the drain)
+    };
+};
+
+// One message waiting in a ring buffer (fixed size, formatted by the drain thread)
+struct Record {
+    std::int64_t timestamp; // steady_clock nanoseconds
+    const char* format;
+    LogLevel level;
+    int argc;
+    std::uint16_t textUsed;
+    Arg args[MaxArgs];
+    char text[TextSize];
+};
+
+// Returns a free record of the calling thread's ring, or nullptr if it is full (the message is dropped)
+Record* begin_record();
+// Publishes the record returned by begin_record() to the drain thread
+void commit_record();
+std::int64_t now();
+
+inline void capture_text(Record& record, Arg& arg, std::string_view value) {
+    if (value.size() <= static_cast<std::size_t>(TextSize - record.textUsed)) {
+        arg.type = Arg::Text;
+        arg.text.offset = record.textUsed;
+        arg.text.length = static_cast<std::uint16_t>(value.size());
+        value.copy(record.text + record.textUsed, value.size());
+        record.textUsed += static_cast<std::uint16_t>(value.size());
+    } else {
+        // Long strings (shader logs, paths) are rare: copy them to the heap rather than truncate
+        arg.type = Arg::HeapText;
+        arg.heap = new char[value.size() + 1];
+        value.copy(arg.heap, value.size());
+        arg.heap[value.size()] = '\0';
+    }
+}
+
+template <typename T>
+void capture(Record& record, Arg& arg, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        arg.type = Arg::Bool;
+        arg.u = value;
+    } else if constexpr (std::is_same_v<T, char>) {
+        arg.type = Arg::Char;
+        arg.i = value;
+    } else if constexpr (std::is_enum_v<T>) {
+        arg.type = Arg::Int;
+        arg.i = static_cast<std::int64_t>(value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        arg.type = Arg::Int;
+        arg.i = value;
+    } else if constexpr (std::is_integral_v<T>) {
+        arg.type = Arg::UInt;
+        arg.u = value;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        arg.type = Arg::Double;
+        arg.d = value;
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        capture_text(record, arg, std::string_view(value));
+    } else {
+        static_assert(std::is_convertible_v<const T&, std::string_view>, "Unsupported log argument type");
+    }
+}
+
+} // namespace log_detail
+
+// Function behind the LOG_* macros: captures the arguments into the calling thread's ring buffer
+// Parameters:
+// - level: Severity of the message
+// - format: String literal with one "{}" per argument
+// - args: The arguments
+template <typename... Args>
+void log_message(LogLevel level, const char* format, const Args&... args) {
+    static_assert(sizeof...(Args) <= log_detail::MaxArgs, "Too many log arguments");
+    log_detail::Record* record = log_detail::begin_record();
+    if (record) {
+        record->timestamp = log_detail::now();
+        record->format = format;
+        record->level = level;
+        record->argc = static_cast<int>(sizeof...(Args));
+        record->textUsed = 0;
+        [[maybe_unused]] int i = 0;
+        (log_detail::capture(*record, record->args[i++], args), ...);
+        log_detail::commit_record();
+    }
+    if (level >= LOG_LEVEL_ERROR) log_flush();
+}
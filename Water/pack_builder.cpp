@@ -0,0 +1,259 @@
+// Builds an asset pack (see asset_pack.hpp) from loose files.
+//
+// Usage: ./pack_builder <output.pak> <file>...
+//   *.bmp   Texture, compressed to BC1 (DXT1) with a full mip chain
+//   r8:*.bmp
+//           Single-channel texture (the red channel, uncompressed) with a full mip chain, for maps
+//           such as displacement where BC1 would lose precision
+//   other   Shader source, stored as text
+// Each asset is stored under the path it was given as, so the program finds it by the same name
+// it would open as a loose file.
+
+#include "asset_pack.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+// An asset waiting to be written
+struct PendingAsset {
+    PackEntry entry;
+    std::vector<unsigned char> data;
+};
+
+// Appends raw bytes to a buffer
+template <typename T>
+static void append(std::vector<unsigned char>& out, const T* values, size_t count) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+    out.insert(out.end(), bytes, bytes + count * sizeof(T));
+}
+
+// Converts 8-bit RGB to RGB565
+static uint16_t packColor(const float c[3]) {
+    int r = std::min(31, std::max(0, static_cast<int>(c[0] * 31.0f / 255.0f + 0.5f)));
+    int g = std::min(63, std::max(0, static_cast<int>(c[1] * 63.0f / 255.0f + 0.5f)));
+    int b = std::min(31, std::max(0, static_cast<int>(c[2] * 31.0f / 255.0f + 0.5f)));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+// Expands RGB565 back to 8-bit RGB
+static void unpackColor(uint16_t c, float out[3]) {
+    out[0] = ((c >> 11) & 31) * 255.0f / 31.0f;
+    out[1] = ((c >> 5) & 63) * 255.0f / 63.0f;
+    out[2] = (c & 31) * 255.0f / 31.0f;
+}
+
+// Compresses one 4x4 block of RGB texels to BC1: endpoints at the ends of the block's bounding box
+// (inset by 1/16 to reduce the error of the extremes), indices picked by nearest palette colour
+static void compressBlock(const float texels[16][3], unsigned char out[8]) {
+    float lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i)
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], texels[i][k]);
+            hi[k] = std::max(hi[k], texels[i][k]);
+        }
+    for (int k = 0; k < 3; ++k) {
+        float inset = (hi[k] - lo[k]) / 16.0f;
+        lo[k] += inset;
+        hi[k] -= inset;
+    }
+
+    uint16_t c0 = packColor(hi), c1 = packColor(lo);
+    if (c0 < c1) std::swap(c0, c1);
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        // Four-colour mode (c0 > c1): c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+        float palette[4][3];
+        unpackColor(c0, palette[0]);
+        unpackColor(c1, palette[1]);
+        for (int k = 0; k < 3; ++k) {
+            palette[2][k] = (2.0f * palette[0][k] + palette[1][k]) / 3.0f;
+            palette[3][k] = (palette[0][k] + 2.0f * palette[1][k]) / 3.0f;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            float bestError = 1e30f;
+            for (int p = 0; p < 4; ++p) {
+                float error = 0;
+                for (int k = 0; k < 3; ++k) {
+                    float d = texels[i][k] - palette[p][k];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// Halves an image with a box filter; odd sizes clamp at the last row and column
+static std::vector<float> downsample(const std::vector<float>& image, uint32_t width, uint32_t height, int channels) {
+    uint32_t w = std::max(width / 2, 1u), h = std::max(height / 2, 1u);
+    std::vector<float> out(static_cast<size_t>(w) * h * channels);
+    for (uint32_t y = 0; y < h; ++y)
+        for (uint32_t x = 0; x < w; ++x)
+            for (int k = 0; k < channels; ++k) {
+                uint32_t x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                uint32_t y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+                out[(static_cast<size_t>(y) * w + x) * channels + k] =
+                    (image[(static_cast<size_t>(y0) * width + x0) * channels + k] +
+                     image[(static_cast<size_t>(y0) * width + x1) * channels + k] +
+                     image[(static_cast<size_t>(y1) * width + x0) * channels + k] +
+                     image[(static_cast<size_t>(y1) * width + x1) * channels + k]) * 0.25f;
+            }
+    return out;
+}
+
+// Builds a texture asset with every mip level
+static bool packTexture(const char* path, bool singleChannel, PendingAsset& asset) {
+    BMPImage bmp;
+    if (!decodeBMP(path, bmp)) return false;
+
+    // BMP rows are BGR(A), bottom row first, padded to 4 bytes; the pack keeps the row order (the
+    // same orientation uploadTextureBMP gives) but stores RGB or R without padding
+    int channels = singleChannel ? 1 : 3;
+    size_t stride = (bmp.width * bmp.bytesPerPixel + 3) & ~static_cast<size_t>(3);
+    std::vector<float> image(static_cast<size_t>(bmp.width) * bmp.height * channels);
+    for (uint32_t y = 0; y < bmp.height; ++y)
+        for (uint32_t x = 0; x < bmp.width; ++x)
+            for (int k = 0; k < channels; ++k)
+                image[(static_cast<size_t>(y) * bmp.width + x) * channels + k] = bmp.data[y * stride + x * bmp.bytesPerPixel + 2 - k];
+
+    PackEntry& entry = asset.entry;
+    entry.type = PACK_TEXTURE;
+    entry.format = singleChannel ? GL_R8 : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    entry.width = bmp.width;
+    entry.height = bmp.height;
+    entry.levels = 0;
+
+    uint32_t width = bmp.width, height = bmp.height;
+    for (;;) {
+        if (singleChannel) {
+            for (float value : image)
+                asset.data.push_back(static_cast<unsigned char>(std::min(255.0f, value + 0.5f)));
+        } else {
+            // Edge texels are repeated into blocks that overhang the level
+            for (uint32_t by = 0; by < height; by += 4)
+                for (uint32_t bx = 0; bx < width; bx += 4) {
+                    float block[16][3];
+                    for (int i = 0; i < 16; ++i) {
+                        uint32_t x = std::min(bx + i % 4, width - 1), y = std::min(by + i / 4, height - 1);
+                        for (int k = 0; k < 3; ++k)
+                            block[i][k] = image[(static_cast<size_t>(y) * width + x) * 3 + k];
+                    }
+                    unsigned char bytes[8];
+                    compressBlock(block, bytes);
+                    append(asset.data, bytes, 8);
+                }
+        }
+        ++entry.levels;
+        if (width == 1 && height == 1) break;
+        image = downsample(image, width, height, channels);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return true;
+}
+
+// Builds a shader asset
+static bool packShader(const char* path, PendingAsset& asset) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Could not open " << path << "\n";
+        return false;
+    }
+    asset.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    asset.data.push_back(0);
+    asset.entry.type = PACK_SHADER;
+    return true;
+}
+
+static bool endsWith(const std::string& s, const char* suffix) {
+    size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <output.pak> [r8:]<file>...\n";
+        return 1;
+    }
+
+    std::vector<PendingAsset> assets;
+    for (int i = 2; i < argc; ++i) {
+        std::string path = argv[i];
+        bool singleChannel = path.compare(0, 3, "r8:") == 0;
+        if (singleChannel) path = path.substr(3);
+        if (path.size() >= sizeof(PackEntry::name)) {
+            std::cerr << "Asset name too long: " << path << "\n";
+            return 1;
+        }
+
+        PendingAsset asset;
+        std::memset(&asset.entry, 0, sizeof(PackEntry));
+        std::strcpy(asset.entry.name, path.c_str());
+        bool ok;
+        if (endsWith(path, ".bmp"))
+            ok = packTexture(path.c_str(), singleChannel, asset);
+        else if (endsWith(path, ".ply")) {
+            std::cerr << "Meshes are not packed (nothing reads them from the pack): " << path << "\n";
+            return 1;
+        } else
+            ok = packShader(path.c_str(), asset);
+        if (!ok) return 1;
+        assets.push_back(std::move(asset));
+    }
+
+    // The reader binary-searches the table of contents
+    std::sort(assets.begin(), assets.end(), [](const PendingAsset& a, const PendingAsset& b) {
+        return std::strcmp(a.entry.name, b.entry.name) < 0;
+    });
+    for (size_t i = 1; i < assets.size(); ++i)
+        if (std::strcmp(assets[i - 1].entry.name, assets[i].entry.name) == 0) {
+            std::cerr << "Duplicate asset: " << assets[i].entry.name << "\n";
+            return 1;
+        }
+
+    // Assign page-aligned offsets after the table of contents
+    auto align = [](uint64_t offset) { return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT; };
+    uint64_t offset = align(sizeof(PackHeader) + assets.size() * sizeof(PackEntry));
+    for (PendingAsset& asset : assets) {
+        asset.entry.offset = offset;
+        asset.entry.size = asset.data.size();
+        offset = align(offset + asset.data.size());
+    }
+
+    std::ofstream out(argv[1], std::ios::binary);
+    PackHeader header = {{'W', 'P', 'A', 'K'}, PACK_VERSION, static_cast<uint32_t>(assets.size()), 0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const PendingAsset& asset : assets)
+        out.write(reinterpret_cast<const char*>(&asset.entry), sizeof(PackEntry));
+    for (const PendingAsset& asset : assets) {
+        out.seekp(static_cast<std::streamoff>(asset.entry.offset));
+        out.write(reinterpret_cast<const char*>(asset.data.data()), static_cast<std::streamsize>(asset.data.size()));
+    }
+    // Pad the last asset to a whole page so the file size matches the offsets
+    out.seekp(0, std::ios::end);
+    if (static_cast<uint64_t>(out.tellp()) < offset) {
+        out.seekp(static_cast<std::streamoff>(offset - 1));
+        out.put(0);
+    }
+    if (!out) {
+        std::cerr << "Failed to write " << argv[1] << "\n";
+        return 1;
+    }
+
+    std::cout << "Packed " << assets.size() << " assets into " << argv[1] << " (" << offset / 1024 << " KB)\n";
+    return 0;
+}
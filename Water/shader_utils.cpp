@@ -1,6 +1,6 @@
 #include "shader_utils.hpp"
+#include "log.hpp"
 
-#include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -9,10 +9,10 @@
 
 // Utility: read file contents
 // Reads the contents of a file into a string
-static std::string readFile(const char* filePath) {
+std::string readShaderFile(const char* filePath) {
     std::ifstream stream(filePath, std::ios::in);
     if (!stream.is_open()) {
-        std::cerr << "Could not open " << filePath << "\n";
+        LOG_ERROR("Could not open {}", filePath);
         return "";
     }
     std::stringstream sstr;
@@ -21,41 +21,46 @@ static std::string readFile(const char* filePath) {
 }
 
 // Utility: compile individual shader
-// Compiles a shader from source code and checks for errors
+// Starts compiling a shader from source code; errors are reported by checkProgram
 static GLuint compileShader(const std::string& code, GLenum type) {
     GLuint id = glCreateShader(type); // Create a shader object
     const char* source = code.c_str();
     glShaderSource(id, 1, &source, nullptr); // Set the shader source code
     glCompileShader(id); // Compile the shader
-
-    // Check for compilation errors
-    GLint result;
-    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-    if (!result) {
-        GLint length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-        std::vector<char> msg(length);
-        glGetShaderInfoLog(id, length, nullptr, msg.data());
-        std::cerr << "Shader compile error:\n" << msg.data() << "\n";
-    }
-
     return id;
 }
 
-// Link all shader stages into a program
-// Loads and links vertex, tessellation, geometry, and fragment shaders into a single program
-GLuint LoadShaders(const char* vertex_file_path,
-                   const char* tess_control_path,
-                   const char* tess_eval_path,
-                   const char* geometry_path,
-                   const char* fragment_file_path) {
+// Read the source code of all shader stages
+ShaderSources readShaderSources(const char* vertex_file_path,
+                                const char* tess_control_path,
+                                const char* tess_eval_path,
+                                const char* geometry_path,
+                                const char* fragment_file_path) {
+    ShaderSources sources;
+    sources.vertex      = readShaderFile(vertex_file_path);
+    sources.tessControl = readShaderFile(tess_control_path);
+    sources.tessEval    = readShaderFile(tess_eval_path);
+    sources.geometry    = readShaderFile(geometry_path);
+    sources.fragment    = readShaderFile(fragment_file_path);
+    return sources;
+}
 
+// Hand shader compilation to driver threads where supported
+void enableParallelShaderCompile() {
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // Let the driver pick the number of threads
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+}
+
+// Compile all shader stages and link them into a program, without querying any status
+GLuint compileProgram(const ShaderSources& sources) {
     // Compile each shader stage
-    GLuint vs  = compileShader(readFile(vertex_file_path), GL_VERTEX_SHADER);
-    GLuint tcs = compileShader(readFile(tess_control_path), GL_TESS_CONTROL_SHADER);
-    GLuint tes = compileShader(readFile(tess_eval_path), GL_TESS_EVALUATION_SHADER);
-    GLuint gs  = compileShader(readFile(geometry_path), GL_GEOMETRY_SHADER);
-    GLuint fs  = compileShader(readFile(fragment_file_path), GL_FRAGMENT_SHADER);
+    GLuint vs  = compileShader(sources.vertex, GL_VERTEX_SHADER);
+    GLuint tcs = compileShader(sources.tessControl, GL_TESS_CONTROL_SHADER);
+    GLuint tes = compileShader(sources.tessEval, GL_TESS_EVALUATION_SHADER);
+    GLuint gs  = compileShader(sources.geometry, GL_GEOMETRY_SHADER);
+    GLuint fs  = compileShader(sources.fragment, GL_FRAGMENT_SHADER);
 
     // Create a program and attach shaders
     GLuint program = glCreateProgram();
@@ -65,8 +70,38 @@ GLuint LoadShaders(const char* vertex_file_path,
     glAttachShader(program, gs);
     glAttachShader(program, fs);
 
-    // Link the program
+    // Link the program; the shaders stay attached until checkProgram so their logs can be read
     glLinkProgram(program);
+    return program;
+}
+
+// Poll the link of a program without blocking
+bool programCompleted(GLuint program) {
+    if (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile)
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done); // Same value as GL_COMPLETION_STATUS_ARB
+    return done == GL_TRUE;
+}
+
+// Report errors of a program and delete its shaders
+bool checkProgram(GLuint program) {
+    GLuint shaders[5];
+    GLsizei count = 0;
+    glGetAttachedShaders(program, 5, &count, shaders);
+
+    // Check for compilation errors
+    for (GLsizei i = 0; i < count; ++i) {
+        GLint result;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &result);
+        if (!result) {
+            GLint length;
+            glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &length);
+            std::vector<char> msg(length + 1, 0);
+            glGetShaderInfoLog(shaders[i], length, nullptr, msg.data());
+            LOG_ERROR("Shader compile error:\n{}", msg.data());
+        }
+    }
 
     // Check for linking errors
     GLint result;
@@ -74,40 +109,63 @@ GLuint LoadShaders(const char* vertex_file_path,
     if (!result) {
         GLint length;
         glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
-        std::vector<char> msg(length);
+        std::vector<char> msg(length + 1, 0);
         glGetProgramInfoLog(program, length, nullptr, msg.data());
-        std::cerr << "Program link error:\n" << msg.data() << "\n";
+        LOG_ERROR("Program link error:\n{}", msg.data());
     }
 
     // Delete shaders after linking (no longer needed)
-    glDeleteShader(vs);
-    glDeleteShader(tcs);
-    glDeleteShader(tes);
-    glDeleteShader(gs);
-    glDeleteShader(fs);
+    for (GLsizei i = 0; i < count; ++i) {
+        glDetachShader(program, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
+    return result == GL_TRUE;
+}
 
+// Link all shader stages into a program
+// Loads and links vertex, tessellation, geometry, and fragment shaders into a single program
+GLuint LoadShaders(const char* vertex_file_path,
+                   const char* tess_control_path,
+                   const char* tess_eval_path,
+                   const char* geometry_path,
+                   const char* fragment_file_path) {
+    GLuint program = compileProgram(readShaderSources(vertex_file_path, tess_control_path, tess_eval_path,
+                                                      geometry_path, fragment_file_path));
+    checkProgram(program);
     return program;
 }
 
-// Load a .bmp texture into OpenGL
-// Loads a BMP file and creates an OpenGL texture
-GLuint loadTextureBMP(const char* filepath) {
+// Function to load a vertex and fragment shader pair and link them into a program
+GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path) {
+    return buildProgram(readShaderFile(vertex_file_path), readShaderFile(fragment_file_path));
+}
+
+// Compile a vertex and fragment shader pair that is already in memory
+GLuint buildProgram(const std::string& vertexSource, const std::string& fragmentSource) {
+    GLuint program = glCreateProgram();
+    glAttachShader(program, compileShader(vertexSource, GL_VERTEX_SHADER));
+    glAttachShader(program, compileShader(fragmentSource, GL_FRAGMENT_SHADER));
+    glLinkProgram(program);
+    checkProgram(program);
+    return program;
+}
+
+// Read a .bmp file into memory
+// Decodes the header and pixel data of a BMP file without touching OpenGL
+bool decodeBMP(const char* filepath, BMPImage& image) {
     // Open the BMP file
     FILE* file = fopen(filepath, "rb");
     if (!file) {
-        std::cerr << "Failed to open BMP: " << filepath << std::endl;
-        return 0;
+        LOG_ERROR("Failed to open BMP: {}", filepath);
+        return false;
     }
 
     // Read the BMP header
     unsigned char header[54];
-    fread(header, 1, 54, file);
-
-    // Verify that the file is a BMP
-    if (header[0] != 'B' || header[1] != 'M') {
-        std::cerr << "Not a BMP file: " << filepath << std::endl;
+    if (fread(header, 1, 54, file) != 54 || header[0] != 'B' || header[1] != 'M') {
+        LOG_ERROR("Not a BMP file: {}", filepath);
         fclose(file);
-        return 0;
+        return false;
     }
 
     // Extract image metadata from the header
@@ -115,31 +173,57 @@ GLuint loadTextureBMP(const char* filepath) {
     unsigned int width      = *(int*)&(header[0x12]); // Image width
     unsigned int height     = *(int*)&(header[0x16]); // Image height
     unsigned int imageSize  = *(int*)&(header[0x22]); // Image size
+    unsigned int bits       = *(short*)&(header[0x1C]); // Bits per pixel
+    if (bits != 24 && bits != 32) {
+        LOG_ERROR("Unsupported BMP ({} bits per pixel): {}", bits, filepath);
+        fclose(file);
+        return false;
+    }
 
     // Default values if not specified in the header
-    if (imageSize == 0) imageSize = width * height * 3; // 3 bytes per pixel (RGB)
+    if (imageSize == 0) imageSize = ((width * bits / 8 + 3) & ~3u) * height; // Rows padded to 4 bytes
     if (dataPos == 0) dataPos = 54; // Default BMP header size
 
     // Read the image data
-    unsigned char* data = new unsigned char[imageSize];
-    fread(data, 1, imageSize, file);
+    image.width = width;
+    image.height = height;
+    image.bytesPerPixel = bits / 8;
+    image.data.resize(imageSize);
+    fseek(file, dataPos, SEEK_SET);
+    size_t read = fread(image.data.data(), 1, imageSize, file);
     fclose(file);
+    if (read != imageSize) {
+        LOG_ERROR("Truncated BMP: {}", filepath);
+        return false;
+    }
+    return true;
+}
 
+// Upload a decoded .bmp into OpenGL
+// Creates a texture from BMP pixels and generates its mipmaps
+GLuint uploadTextureBMP(const BMPImage& image) {
     // Generate and bind a texture in OpenGL
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
 
     // Upload the image data to the texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0,
-                 GL_BGR, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0,
+                 image.bytesPerPixel == 4 ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, image.data.data());
 
     // Set texture filtering and generate mipmaps
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glGenerateMipmap(GL_TEXTURE_2D);
 
-    // Free the image data and return the texture ID
-    delete[] data;
     return textureID;
 }
+
+// Load a .bmp texture into OpenGL
+// Loads a BMP file and creates an OpenGL texture
+GLuint loadTextureBMP(const char* filepath) {
+    BMPImage image;
+    if (!decodeBMP(filepath, image))
+        return 0;
+    return uploadTextureBMP(image);
+}
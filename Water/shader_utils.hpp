@@ -1,5 +1,7 @@
 #pragma once
 #include <GL/glew.h>
+#include <vector>
+#include <string>
 
 // Function to load and compile shaders, and link them into a program
 // Parameters:
@@ -16,9 +18,92 @@ GLuint LoadShaders(const char* vertex_file_path,
                    const char* geometry_path,
                    const char* fragment_file_path);
 
+// Function to load a vertex and fragment shader pair and link them into a program
+// Parameters:
+// - vertex_file_path: Path to the vertex shader file
+// - fragment_file_path: Path to the fragment shader file
+// Returns:
+// - GLuint: The ID of the linked shader program
+GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path);
+
+// Function to compile a vertex and fragment shader pair from source code and link them into a program
+// Parameters:
+// - vertexSource: Source code of the vertex shader
+// - fragmentSource: Source code of the fragment shader
+// Returns:
+// - GLuint: The ID of the linked shader program
+GLuint buildProgram(const std::string& vertexSource, const std::string& fragmentSource);
+
+// Source code of the five stages of a program
+struct ShaderSources {
+    std::string vertex, tessControl, tessEval, geometry, fragment;
+};
+
+// Function to read a shader file into a string
+// Parameters:
+// - filePath: Path to the file
+// Returns:
+// - std::string: The file contents (empty if the file could not be read)
+std::string readShaderFile(const char* filePath);
+
+// Function to read the five shader stages from disk; makes no GL calls, so it can run on any thread
+// Parameters:
+// - vertex_file_path ... fragment_file_path: Same as LoadShaders
+// Returns:
+// - ShaderSources: The file contents (empty strings for files that could not be read)
+ShaderSources readShaderSources(const char* vertex_file_path,
+                                const char* tess_control_path,
+                                const char* tess_eval_path,
+                                const char* geometry_path,
+                                const char* fragment_file_path);
+
+// Function to let the driver compile shaders on its own threads (GL_KHR_parallel_shader_compile or
+// GL_ARB_parallel_shader_compile); does nothing if neither is available
+void enableParallelShaderCompile();
+
+// Function to start compiling and linking a program without waiting for the result
+// Parameters:
+// - sources: The shader stages
+// Returns:
+// - GLuint: The ID of the program; check it with programCompleted and checkProgram
+GLuint compileProgram(const ShaderSources& sources);
+
+// Function to ask whether a program started with compileProgram has finished linking
+// Returns:
+// - bool: True when checkProgram will not block (always true without parallel compile)
+bool programCompleted(GLuint program);
+
+// Function to report compile and link errors of a program started with compileProgram and release
+// its shader objects; blocks until linking is done
+// Returns:
+// - bool: True if the program linked
+bool checkProgram(GLuint program);
+
 // Function to load a BMP texture into OpenGL
 // Parameters:
 // - filepath: Path to the BMP file
 // Returns:
 // - GLuint: The ID of the generated OpenGL texture
 GLuint loadTextureBMP(const char* filepath);
+
+// Pixels of a decoded 24-bit BMP file (BGR, bottom row first)
+struct BMPImage {
+    unsigned int width = 0, height = 0;
+    unsigned int bytesPerPixel = 3; // 3 (BGR) or 4 (BGRA)
+    std::vector<unsigned char> data;
+};
+
+// Function to read a BMP file into memory; makes no GL calls, so it can run on any thread
+// Parameters:
+// - filepath: Path to the BMP file
+// - image: Receives the pixels
+// Returns:
+// - bool: False if the file could not be read
+bool decodeBMP(const char* filepath, BMPImage& image);
+
+// Function to create a mipmapped OpenGL texture from a decoded BMP
+// Parameters:
+// - image: The decoded pixels
+// Returns:
+// - GLuint: The ID of the generated OpenGL texture
+GLuint uploadTextureBMP(const BMPImage& image);
@@ -0,0 +1,283 @@
+#include "sweep.hpp"
+#include "PlaneMesh.hpp"
+#include "gpu_timer.hpp"
+#include "log.hpp"
+
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const int FramesInFlight = 2; // Like a double-buffered swap chain, so the CPU cannot run far ahead
+
+// Reads the remaining words of a line as numbers
+template <typename T>
+bool readValues(std::istringstream& line, std::vector<T>& values) {
+    std::vector<T> read;
+    T value;
+    while (line >> value)
+        read.push_back(value);
+    if (read.empty() || !line.eof()) return false;
+    values = read;
+    return true;
+}
+
+bool readValue(std::istringstream& line, int& value) {
+    std::vector<int> values;
+    if (!readValues(line, values) || values.size() != 1) return false;
+    value = values[0];
+    return true;
+}
+
+// Reads "WIDTHxHEIGHT" pairs
+bool readResolutions(std::istringstream& line, std::vector<int>& widths, std::vector<int>& heights) {
+    std::vector<int> w, h;
+    std::string word;
+    while (line >> word) {
+        int width = 0, height = 0;
+        char x = 0, extra = 0;
+        if (std::sscanf(word.c_str(), "%d%c%d%c", &width, &x, &height, &extra) != 3 || x != 'x' ||
+            width <= 0 || height <= 0)
+            return false;
+        w.push_back(width);
+        h.push_back(height);
+    }
+    if (w.empty()) return false;
+    widths = w;
+    heights = h;
+    return true;
+}
+
+// Offscreen scene target of one resolution
+struct Target {
+    GLuint fbo = 0, color = 0, depth = 0;
+    int width = 0, height = 0;
+
+    bool allocate(int width, int height, int samples) {
+        release();
+        this->width = width;
+        this->height = height;
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete) {
+            // Leave no size behind, so the next configuration of the same size tries again
+            release();
+            this->width = this->height = 0;
+        }
+        return complete;
+    }
+
+    void release() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        fbo = color = depth = 0;
+    }
+};
+
+double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+// Nearest-rank percentile
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+    return values[std::min(std::max(rank, size_t(1)), values.size()) - 1];
+}
+
+} // namespace
+
+// Step and extent are the outer loops: changing them rebuilds the plane
+std::vector<SweepConfig> SweepGrid::configs() const {
+    std::vector<SweepConfig> all;
+    size_t resolutions = std::min(widths.size(), heights.size());
+    for (float extent : extents)
+        for (float step : steps)
+            for (size_t r = 0; r < resolutions; ++r)
+                for (float tess : tessellations)
+                    for (int count : waves)
+                        all.push_back(SweepConfig{widths[r], heights[r], step, extent, tess, count});
+    return all;
+}
+
+bool readSweepGrid(const char* path, SweepGrid& grid) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("Could not open sweep grid {}", path);
+        return false;
+    }
+    std::string text;
+    for (int number = 1; std::getline(file, text); ++number) {
+        text = text.substr(0, text.find('#'));
+        std::istringstream line(text);
+        std::string name;
+        if (!(line >> name)) continue; // Blank or comment
+
+        bool ok;
+        if (name == "resolution") ok = readResolutions(line, grid.widths, grid.heights);
+        else if (name == "step") ok = readValues(line, grid.steps);
+        else if (name == "extent") ok = readValues(line, grid.extents);
+        else if (name == "tessellation") ok = readValues(line, grid.tessellations);
+        else if (name == "waves") ok = readValues(line, grid.waves);
+        else if (name == "frames") ok = readValue(line, grid.frames) && grid.frames > 0;
+        else if (name == "warmup") ok = readValue(line, grid.warmup) && grid.warmup >= 0;
+        else if (name == "samples") ok = readValue(line, grid.samples) && grid.samples >= 0;
+        else ok = false;
+        if (!ok) {
+            LOG_ERROR("{}:{}: bad sweep setting '{}'", path, number, name);
+            return false;
+        }
+    }
+    for (float step : grid.steps) {
+        if (step <= 0.0f) {
+            LOG_ERROR("{}: steps must be positive", path);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool runSweep(const SweepGrid& grid, const char* csvPath) {
+    if (!GLEW_ARB_timer_query) {
+        LOG_ERROR("GPU timer queries are not supported; cannot sweep");
+        return false;
+    }
+    std::FILE* csv = std::fopen(csvPath, "w");
+    if (!csv) {
+        LOG_ERROR("Could not write {}", csvPath);
+        return false;
+    }
+    std::fprintf(csv, "width,height,step,extent,tessellation,waves,frames,cpu_ms,gpu_ms,gpu_ms_p95,frame_ms,primitives\n");
+
+    glClearColor(0.2f, 0.2f, 0.3f, 0.0f);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glm::vec3 lightpos(5.0f, 30.0f, 5.0f);
+
+    std::vector<SweepConfig> configs = grid.configs();
+    std::unique_ptr<PlaneMesh> plane;
+    Target target;
+    std::vector<GLuint> primitiveQueries(grid.frames);
+    glGenQueries(grid.frames, primitiveQueries.data());
+    int failed = 0; // Configurations that could not be run
+
+    for (size_t c = 0; c < configs.size(); ++c) {
+        const SweepConfig& config = configs[c];
+        if (!plane || config.step != configs[c - 1].step || config.extent != configs[c - 1].extent) {
+            if (plane) plane->release();
+            plane.reset(new PlaneMesh(-config.extent, config.extent, config.step));
+        }
+        plane->setTessellation(config.tessellation, config.tessellation);
+        plane->setWaveCount(config.waves);
+        if (target.width != config.width || target.height != config.height) {
+            if (!target.allocate(config.width, config.height, grid.samples)) {
+                // Record the configuration without measurements and go on with the others
+                LOG_ERROR("Could not create a {}x{} target", config.width, config.height);
+                std::fprintf(csv, "%d,%d,%g,%g,%g,%d,0,,,,,\n", config.width, config.height, config.step,
+                             config.extent, config.tessellation, config.waves);
+                std::fflush(csv);
+                ++failed;
+                continue;
+            }
+        }
+
+        glm::mat4 Projection = glm::perspective(glm::radians(45.0f), float(config.width) / config.height, 0.001f, 1000.0f);
+        glm::mat4 V;
+
+        GpuTimer timer;
+        GLsync fences[FramesInFlight] = {};
+        std::vector<double> cpuMs, gpuMs;
+        double ms;
+        auto measureStart = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < grid.warmup + grid.frames; ++frame) {
+            int measured = frame - grid.warmup; // Index among the measured frames, negative while warming up
+            if (measured == 0) measureStart = std::chrono::steady_clock::now();
+
+            // Keep at most FramesInFlight frames queued
+            GLsync& fence = fences[frame % FramesInFlight];
+            if (fence) {
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(10) * 1000 * 1000 * 1000);
+                glDeleteSync(fence);
+                fence = 0;
+            }
+
+            auto cpuStart = std::chrono::steady_clock::now();
+            if (measured >= 0) timer.begin();
+            plane->updateFoam();
+            glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+            glViewport(0, 0, target.width, target.height);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            cameraControlsGlobe(V, 5);
+            if (measured >= 0) glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[measured]);
+            plane->draw(lightpos, V, Projection);
+            if (measured >= 0) {
+                glEndQuery(GL_PRIMITIVES_GENERATED);
+                timer.end();
+                cpuMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count());
+            }
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+
+            while (timer.result(ms))
+                gpuMs.push_back(ms);
+            glfwPollEvents();
+        }
+        glFinish();
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - measureStart).count() / grid.frames;
+        while (timer.result(ms))
+            gpuMs.push_back(ms);
+        for (GLsync fence : fences)
+            if (fence) glDeleteSync(fence);
+
+        GLuint64 primitives = 0;
+        for (GLuint query : primitiveQueries) {
+            GLuint64 count = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &count);
+            primitives += count;
+        }
+
+        double gpuMean = mean(gpuMs);
+        std::fprintf(csv, "%d,%d,%g,%g,%g,%d,%d,%.3f,%.3f,%.3f,%.3f,%llu\n", config.width, config.height, config.step,
+                     config.extent, config.tessellation, plane->waveCount(), grid.frames, mean(cpuMs), gpuMean,
+                     percentile(gpuMs, 0.95), frameMs, static_cast<unsigned long long>(primitives / grid.frames));
+        std::fflush(csv);
+        LOG_INFO("Sweep {}/{}: {}x{}, step {}, extent {}, tessellation {}, {} waves: GPU {} ms, {} primitives",
+                 c + 1, configs.size(), config.width, config.height, config.step, config.extent, config.tessellation,
+                 plane->waveCount(), gpuMean, primitives / grid.frames);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteQueries(grid.frames, primitiveQueries.data());
+    target.release();
+    if (plane) plane->release();
+    std::fclose(csv);
+    if (failed > 0)
+        LOG_ERROR("{} of {} configurations could not be run; their rows have no measurements", failed, configs.size());
+    return failed == 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+// One combination of a parameter sweep
+struct SweepConfig {
+    int width, height;  // Size of the offscreen target
+    float step;         // Size of a plane patch
+    float extent;       // The plane covers [-extent, extent] in x and z
+    float tessellation; // Inner and outer tessellation level
+    int waves;          // Gerstner waves drawn
+};
+
+// Grid of values to sweep; every combination is rendered
+struct SweepGrid {
+    std::vector<int> widths{1500}, heights{1500}; // Resolutions, paired by index
+    std::vector<float> steps{1.0f};
+    std::vector<float> extents{10.0f};
+    std::vector<float> tessellations{16.0f};
+    std::vector<int> waves{8};
+    int frames = 120;  // Frames measured per configuration
+    int warmup = 10;   // Frames drawn before measuring
+    int samples = 4;   // Multisample count of the target (the window uses 4)
+
+    // Returns every combination, ordered so that the plane (step and extent) changes least often
+    std::vector<SweepConfig> configs() const;
+};
+
+// Function to read a sweep grid file: one setting per line, a name followed by its values.
+// Lists multiply into the grid; '#' starts a comment.
+//     resolution 800x600 1500x1500
+//     step 1 0.5
+//     extent 10
+//     tessellation 4 16 64
+//     waves 2 8
+//     frames 120
+//     warmup 10
+//     samples 4
+// Parameters:
+// - path: The grid file
+// - grid: Receives the settings; those missing from the file keep their defaults
+// Returns:
+// - bool: False if the file cannot be read or has an unknown setting or a bad value
+bool readSweepGrid(const char* path, SweepGrid& grid);
+
+// Function to render every configuration of a grid headlessly into an offscreen target and write
+// one CSV row per configuration: CPU and GPU frame times and primitive counts. Rows are flushed as
+// they finish, so a long sweep can be watched or interrupted. A configuration whose target cannot be
+// created gets a row with 0 frames and empty measurements, and the sweep goes on. Needs a current
+// OpenGL context.
+// Parameters:
+// - grid: The configurations to run
+// - csvPath: Output file
+// Returns:
+// - bool: False if the output cannot be written, the context cannot time the GPU or a configuration
+//   could not be run
+bool runSweep(const SweepGrid& grid, const char* csvPath);
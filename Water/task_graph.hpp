@@ -0,0 +1,47 @@
+#pragma once
+
+#include <future>
+#include <functional>
+#include <vector>
+#include <chrono>
+
+// Minimal task graph for startup work.
+// Every task runs on its own thread as soon as the tasks it depends on have finished, so
+// independent steps (file reads, decoding, mesh generation) overlap with each other and with
+// window and context creation on the main thread. A task that throws makes its dependents throw too.
+class TaskGraph {
+public:
+    typedef std::shared_future<void> Task;
+
+    // Function to add a task
+    // Parameters:
+    // - work: The task body; runs on a worker thread, so it must not make GL calls
+    // - dependencies: Tasks that must finish first
+    // Returns:
+    // - Task: Handle to wait on or to pass as a dependency
+    Task add(std::function<void()> work, std::vector<Task> dependencies = {}) {
+        Task task = std::async(std::launch::async, [work, dependencies]() {
+            for (const Task& dependency : dependencies)
+                dependency.get();
+            work();
+        }).share();
+        tasks.push_back(task);
+        return task;
+    }
+
+    // Returns true if the task has finished, without blocking
+    static bool finished(const Task& task) {
+        return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // Waits for every task
+    void wait() {
+        for (const Task& task : tasks)
+            task.wait();
+    }
+
+    ~TaskGraph() { wait(); }
+
+private:
+    std::vector<Task> tasks;
+};
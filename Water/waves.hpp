@@ -0,0 +1,56 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+
+// Largest number of waves the shaders accept; must match MAX_WAVES in WaterShader.geoshader
+const int MAX_WAVES = 16;
+
+// One Gerstner wave: displaces p by (Q A D.x cos a, A sin a, Q A D.y cos a) with a = w dot(D, p.xz) + phi t
+struct GerstnerWave {
+    float frequency;     // w
+    float amplitude;     // A
+    float speed;         // phi
+    float steepness;     // Q
+    glm::vec2 direction; // D
+};
+
+// Function to build the default sea state
+// The first two waves are the original swell; the rest add smaller, shorter detail. Waves are
+// ordered by decreasing amplitude, so drawing only the first n keeps the most visible ones.
+// The sum of Q * A * w stays below 1, so crests never fold over.
+// Returns:
+// - std::vector<GerstnerWave>: The waves (at most MAX_WAVES)
+inline std::vector<GerstnerWave> defaultWaves() {
+    return {
+        {4.0f,  0.08f,  1.0f, 0.75f, glm::vec2(0.3f, 0.6f)},
+        {2.0f,  0.05f,  1.5f, 0.6f,  glm::vec2(0.2f, 0.866f)},
+        {6.0f,  0.03f,  1.8f, 0.5f,  glm::vec2(-0.7f, 0.7f)},
+        {8.0f,  0.02f,  2.2f, 0.5f,  glm::vec2(0.9f, -0.4f)},
+        {11.0f, 0.014f, 2.6f, 0.4f,  glm::vec2(-0.3f, -0.95f)},
+        {15.0f, 0.01f,  3.0f, 0.4f,  glm::vec2(0.6f, 0.8f)},
+        {20.0f, 0.007f, 3.5f, 0.3f,  glm::vec2(-0.95f, 0.3f)},
+        {27.0f, 0.005f, 4.0f, 0.3f,  glm::vec2(0.1f, -1.0f)},
+    };
+}
+
+// Function to pass the first waves of a table to a program (waveCount, waveParams, waveDirections)
+// Parameters:
+// - program: The program, which must be in use
+// - waves: The wave table
+// - count: Number of waves to pass (at most MAX_WAVES)
+inline void setWaveUniforms(GLuint program, const std::vector<GerstnerWave>& waves, int count) {
+    glm::vec4 params[MAX_WAVES];
+    glm::vec2 directions[MAX_WAVES];
+    for (int i = 0; i < count; ++i) {
+        params[i] = glm::vec4(waves[i].frequency, waves[i].amplitude, waves[i].speed, waves[i].steepness);
+        directions[i] = waves[i].direction;
+    }
+    glUniform1i(glGetUniformLocation(program, "waveCount"), count);
+    if (count > 0) {
+        glUniform4fv(glGetUniformLocation(program, "waveParams"), count, glm::value_ptr(params[0]));
+        glUniform2fv(glGetUniformLocation(program, "waveDirections"), count, glm::value_ptr(directions[0]));
+    }
+}